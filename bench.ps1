@@ -0,0 +1,12 @@
+if (-not (Test-Path -Path ".\out")) {
+    New-Item -Path "." -Name "out" -ItemType "Directory"
+}
+
+gcc -O2 src\mandelbrot.c src\bench.c -o out\bench.exe
+if ( $LastExitCode -ne 0)
+{
+    echo "Failed to compile"
+    Exit
+}
+
+.\out\bench.exe
@@ -0,0 +1,41 @@
+param(
+    [Parameter(Position=0, Mandatory=$true)]
+    [string]$file,
+
+    [Parameter(Position=1, Mandatory=$true)]
+    [int]$width,
+
+    [Parameter(Position=2, Mandatory=$true)]
+    [int]$height,
+
+    [Parameter(Position=3)]
+    [double]$millions = 10,
+
+    [Parameter(Position=4)]
+    [int]$rounds = 10,
+
+    [Parameter(Position=5)]
+    [int]$threads = 0,
+
+    [switch]$anti
+)
+
+if (-not (Test-Path -Path ".\out")) {
+    New-Item -Path "." -Name "out" -ItemType "Directory"
+}
+
+gcc -O2 src\mandelbrot.c src\renderer.c src\tiles.c src\framering.c src\buddha.c -o out\buddha.exe -lwinmm
+if ( $LastExitCode -ne 0)
+{
+    echo "Failed to compile"
+    Exit
+}
+
+if ( $anti )
+{
+    .\out\buddha.exe $file $width $height $millions $rounds $threads -anti
+}
+else
+{
+    .\out\buddha.exe $file $width $height $millions $rounds $threads
+}
@@ -0,0 +1,35 @@
+param(
+    [Parameter(Position=0, Mandatory=$true)]
+    [string]$file,
+
+    [Parameter(Position=1, Mandatory=$true)]
+    [int]$width,
+
+    [Parameter(Position=2, Mandatory=$true)]
+    [int]$height,
+
+    [Parameter(Position=3, Mandatory=$true)]
+    [int]$iterations,
+
+    [Parameter(Position=4)]
+    [int]$steps = 4,
+
+    [Parameter(Position=5)]
+    [int]$threads = 0,
+
+    [Parameter(Position=6)]
+    [int]$formula = 1
+)
+
+if (-not (Test-Path -Path ".\out")) {
+    New-Item -Path "." -Name "out" -ItemType "Directory"
+}
+
+gcc -O2 src\mandelbrot.c src\renderer.c src\tiles.c src\framering.c src\deepen.c -o out\deepen.exe -lwinmm
+if ( $LastExitCode -ne 0)
+{
+    echo "Failed to compile"
+    Exit
+}
+
+.\out\deepen.exe $file $width $height $iterations $steps $threads $formula
@@ -0,0 +1,20 @@
+param(
+    [Parameter(Position=0)]
+    [string]$name = "brotFrames",
+
+    [Parameter(Position=1)]
+    [int]$seconds = 10
+)
+
+if (-not (Test-Path -Path ".\out")) {
+    New-Item -Path "." -Name "out" -ItemType "Directory"
+}
+
+gcc -O2 src\framewatch.c -o out\framewatch.exe
+if ( $LastExitCode -ne 0)
+{
+    echo "Failed to compile"
+    Exit
+}
+
+.\out\framewatch.exe $name $seconds
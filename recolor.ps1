@@ -0,0 +1,26 @@
+param(
+    [Parameter(Position=0, Mandatory=$true)]
+    [string]$file,
+
+    [Parameter(Position=1, Mandatory=$true)]
+    [string]$prefix,
+
+    [Parameter(Position=2)]
+    [int]$palettes = 8,
+
+    [Parameter(Position=3)]
+    [int]$threads = 4
+)
+
+if (-not (Test-Path -Path ".\out")) {
+    New-Item -Path "." -Name "out" -ItemType "Directory"
+}
+
+gcc -O2 src\recolor.c -o out\recolor.exe
+if ( $LastExitCode -ne 0)
+{
+    echo "Failed to compile"
+    Exit
+}
+
+.\out\recolor.exe $file $prefix $palettes $threads
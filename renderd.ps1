@@ -0,0 +1,17 @@
+param(
+    [Parameter(Position=0)]
+    [int]$threads = 0
+)
+
+if (-not (Test-Path -Path ".\out")) {
+    New-Item -Path "." -Name "out" -ItemType "Directory"
+}
+
+gcc -O2 src\mandelbrot.c src\renderer.c src\tiles.c src\framering.c src\renderd.c -o out\renderd.exe -lwinmm
+if ( $LastExitCode -ne 0)
+{
+    echo "Failed to compile"
+    Exit
+}
+
+.\out\renderd.exe $threads
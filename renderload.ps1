@@ -0,0 +1,23 @@
+param(
+    [Parameter(Position=0)]
+    [int]$clients = 8,
+
+    [Parameter(Position=1)]
+    [int]$seconds = 10,
+
+    [Parameter(Position=2)]
+    [int]$interactive = 80
+)
+
+if (-not (Test-Path -Path ".\out")) {
+    New-Item -Path "." -Name "out" -ItemType "Directory"
+}
+
+gcc -O2 src\renderload.c -o out\renderload.exe
+if ( $LastExitCode -ne 0)
+{
+    echo "Failed to compile"
+    Exit
+}
+
+.\out\renderload.exe $clients $seconds $interactive
@@ -0,0 +1,23 @@
+param(
+    [Parameter(Position=0, Mandatory=$true)]
+    [string]$file,
+
+    [Parameter(Position=1)]
+    [double]$speed = 1,
+
+    [Parameter(Position=2)]
+    [int]$threads = 0
+)
+
+if (-not (Test-Path -Path ".\out")) {
+    New-Item -Path "." -Name "out" -ItemType "Directory"
+}
+
+gcc -O2 src\mandelbrot.c src\renderer.c src\tiles.c src\framering.c src\replay.c -o out\replay.exe -lwinmm
+if ( $LastExitCode -ne 0)
+{
+    echo "Failed to compile"
+    Exit
+}
+
+.\out\replay.exe $file $speed $threads
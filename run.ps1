@@ -2,14 +2,21 @@ param(
     [Parameter(Position=0)]
     [int]$threads,
 
-    [switch]$console
+    [Parameter(Position=1)]
+    [string]$tiles,
+
+    [switch]$console,
+
+    [switch]$export,
+
+    [string]$record
 )
 
 if (-not (Test-Path -Path ".\out")) {
     New-Item -Path "." -Name "out" -ItemType "Directory"
 }
 
-gcc src\mandelbrot.c src\renderer.c src\window.c -o out\brot.exe -lgdi32 -lwinmm
+gcc src\mandelbrot.c src\renderer.c src\tiles.c src\framering.c src\window.c -o out\brot.exe -lgdi32 -lwinmm
 if ( $LastExitCode -ne 0)
 {
     echo "Failed to compile"
@@ -32,16 +39,19 @@ else
     echo "mtLocation.cfg not found. Configure this file with path to mt.exe file."
 }
 
+$exportArgument = if ( $export ) { "-export" } else { "" }
+$recordArgument = if ( $record ) { @("-record", $record) } else { @() }
+
 if ( $console )
 {
-    .\out\brot.exe $threads
+    .\out\brot.exe $threads $tiles $exportArgument $recordArgument
 }
 else
 {
     Remove-Item "out\brot.log"
     echo "Starting brot.exe"
     Start-Process -FilePath ".\out\brot.exe $threads" `
-        -ArgumentList $threads `
+        -ArgumentList "$threads $tiles $exportArgument $recordArgument" `
         -RedirectStandardOutput "out\brot.log" `
         -NoNewWindow -Wait
 }
@@ -2,7 +2,7 @@ if (-not (Test-Path -Path ".\out")) {
     New-Item -Path "." -Name "out" -ItemType "Directory"
 }
 
-gcc src/mandelbrot.c src/renderer.c src/window.c -o out\brot.exe -lgdi32 -lwinmm -gdwarf-2
+gcc src/mandelbrot.c src/renderer.c src/tiles.c src/framering.c src/window.c -o out\brot.exe -lgdi32 -lwinmm -gdwarf-2
 if ( $LastExitCode -ne 0)
 {
     echo "Failed to compile"
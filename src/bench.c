@@ -0,0 +1,302 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "mandelbrot.h"
+
+#define BENCH_WIDTH 800
+#define BENCH_HEIGHT 600
+#define BENCH_MAX_ITERS 1000
+#define BENCH_REPEATS 5
+
+typedef struct {
+    const char *name;
+    double offsetX; double offsetY; double zoom;
+} BenchView;
+
+static const BenchView views[] = {
+    { "full set", -0.6, 0, 1.5 },
+    { "initial", -0.74, -0.22, 0.01 },
+    { "old default", -0.6, 0, 0.2 },
+    // Outside the set, where pixels escape within a few iterations and per pixel overhead dominates
+    { "exterior", 0, 2.5, 0.5 },
+    { "outer edge", 1, 1, 0.3 },
+};
+#define EXTERIOR_VIEW 3
+
+typedef struct {
+    const char *name;
+    short hstriping; bool hfillIn;
+    /** Region 1 ends at r1xEnd, region 2 spans from r2xStart to the right edge if set */
+    int r1xEnd; bool region2; int r2xStart;
+    /** Pixels the kernel iterates */
+    int computed;
+} BenchShape;
+
+/** The task shapes the renderer hands the kernel, each has its own copy of the pixel loop */
+static const BenchShape shapes[] = {
+    { "plain", 0, false, BENCH_WIDTH, false, 0, BENCH_WIDTH * BENCH_HEIGHT },
+    { "striped", 3, false, BENCH_WIDTH, false, 0, BENCH_WIDTH / 3 * BENCH_HEIGHT },
+    { "stripedfill", 3, true, BENCH_WIDTH, false, 0, BENCH_WIDTH / 3 * BENCH_HEIGHT },
+    { "tworegion", 0, false, BENCH_WIDTH / 8, true, BENCH_WIDTH * 7 / 8, BENCH_WIDTH / 4 * BENCH_HEIGHT },
+};
+
+static LARGE_INTEGER perfFrequency;
+
+static double nowMs() {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart * 1000 / perfFrequency.QuadPart;
+}
+
+/**
+ * calculate() as it was before formulas, the z^2 + c loop with every task shape handled in the one pixel loop,
+ * to compare against
+ */
+static void calculateReference(
+    fracInt *target, int maxIters,
+    double centerX, double centerY,
+    double pixelStep,
+    int width, int height,
+    short hstriping, short hstripeOffset, bool hfillIn,
+    short vstriping, short vstripeOffset, bool vfillIn,
+    int yStart, int yEnd,
+    int r1xStart, int r1xEnd,
+    bool region2, int r2xStart, int r2xEnd
+) {
+    int left   = -(int)floor((float)width / 2);
+    int right  = (int)ceil((float)width / 2);
+    int top    = -(int)floor((float)height / 2);
+    int bottom = (int)ceil((float)height / 2);
+
+    if (!region2) {
+        r2xEnd = r1xEnd;
+    }
+    int region2Jump = r2xStart - r1xEnd;
+
+    int yInc = 1, xInc = 1;
+    short yStripeOffset = 0, r1xStripeOffset = 0, r2xStripeOffset = 0;
+    // Align starts with striping and offset (move right by as little as possible)
+    if (vstriping >= 2) {
+        yInc = vstriping;
+        yStripeOffset = (10000 * vstriping - (top + yStart) + vstripeOffset) % vstriping;
+    }
+    if (hstriping >= 2) {
+        xInc = hstriping;
+        r1xStripeOffset = (10000 * hstriping - (left + r1xStart) + hstripeOffset) % hstriping;
+        if (region2) {
+            r2xStripeOffset = (10000 * hstriping - (left + r2xStart) + hstripeOffset) % hstriping;
+            // We are incrementing from r1xStart by hstriping, therefore once the iterator reaches r1xEnd,
+            // it will be at r1xEnd aligned by striping. We can align it ourselves for ease of calculating jump.
+            int r1xStripeEndOffset = (10000 * hstriping - (left + r1xEnd) + hstripeOffset) % hstriping;
+            region2Jump = r2xStart + r2xStripeOffset - (r1xEnd + r1xStripeEndOffset);
+        }
+    }
+
+    fracInt *iter = target + (yStart + yStripeOffset) * width;
+    size_t rowStep = width * yInc;
+    for (
+        int iy = top + yStart + yStripeOffset, py = yStart + yStripeOffset, row = 0;
+        iy < bottom && py < yEnd;
+        iy += yInc, py += yInc, row++
+    ) {
+        double y = centerY + pixelStep * iy;
+
+        for (
+            int ix = left + r1xStart + r1xStripeOffset, px = r1xStart + r1xStripeOffset, col = 0;
+            ix < right && px < r2xEnd;
+            ix += xInc, px += xInc, col++
+        ) {
+            // If region2 is disabled, r1xEnd = r2xEnd
+            if (px >= r1xEnd && px < r2xStart) {
+                ix += region2Jump;
+                px += region2Jump;
+            }
+            double x = centerX + pixelStep * ix;
+            // Real and Imaginary components
+            double cr = 0;
+            double ci = 0;
+            fracInt iters = 0;
+            while (cr < 4 && cr > -4 && ci < 4 && ci > -4 && iters < maxIters) {
+                iters++;
+                double newCr = cr * cr - ci * ci + x;
+                ci = 2 * cr * ci + y;
+                cr = newCr;
+            }
+            *(iter + px) = iters;
+            if (hfillIn) {
+                // Fill left
+                if (col == 0 && r1xStripeOffset > 0) {
+                    for (int filli = 1; filli <= r1xStripeOffset; filli++)
+                        *(iter + px - filli) = iters;
+                } else if (region2 && r2xStripeOffset > 0 && px == r2xStart + r2xStripeOffset) {
+                    for (int filli = 1; filli <= r2xStripeOffset; filli++)
+                        *(iter + px - filli) = iters;
+                }
+                // Fill right
+                int boundary = px < r1xEnd ? r1xEnd : r2xEnd;
+                for (int destPx = px + 1, destCol = 1; destPx < boundary && destCol < hstriping; destPx++, destCol++)
+                    *(iter + destPx) = iters;
+            }
+        }
+
+        // Fill in skipped stripes
+        if (vfillIn) {
+            size_t r1rowLength = (r1xEnd - r1xStart) * sizeof(fracInt);
+            size_t r2rowLength = (r2xEnd - r2xStart) * sizeof(fracInt);
+            // Fill above
+            if (row == 0 && yStripeOffset > 0) {
+                for (int filli = 1; filli <= yStripeOffset; filli++) {
+                    memcpy(iter - filli * width + r1xStart, iter + r1xStart, r1rowLength);
+                    if (region2) memcpy(iter - filli * width + r2xStart, iter + r2xStart, r2rowLength);
+                }
+            }
+            // Fill below
+            fracInt *destIter = iter;
+            for (
+                int destPy = py + 1, destRow = 1;
+                destPy < yEnd && destRow < vstriping;
+                destPy++, destRow++
+            ) {
+                destIter += width;
+                memcpy(destIter + r1xStart, iter + r1xStart, r1rowLength);
+                if (region2) memcpy(destIter + r2xStart, iter + r2xStart, r2rowLength);
+            }
+        }
+
+        iter += rowStep;
+    }
+}
+
+static uint64_t sumIters(const fracInt *target, int count) {
+    uint64_t sum = 0;
+    for (int i = 0; i < count; i++) sum += target[i];
+    return sum;
+}
+
+/** Best of BENCH_REPEATS in ms, whole frame as a single task */
+static double benchKernel(const Formula *formula, Precision precision, fracInt *target, double offsetX, double offsetY, double zoom) {
+    double pixelStep = zoom * 2 / min(BENCH_WIDTH, BENCH_HEIGHT);
+    double best = 1e30;
+    for (int i = 0; i < BENCH_REPEATS; i++) {
+        double start = nowMs();
+        if (formula) {
+            formula->calculate[precision](target, BENCH_MAX_ITERS, formula->paramR, formula->paramI,
+                offsetX, offsetY, pixelStep, BENCH_WIDTH, BENCH_HEIGHT,
+                0, 0, false, 0, 0, false,
+                0, BENCH_HEIGHT, 0, BENCH_WIDTH, false, 0, 0);
+        } else {
+            calculateReference(target, BENCH_MAX_ITERS, offsetX, offsetY, pixelStep, BENCH_WIDTH, BENCH_HEIGHT,
+                0, 0, false, 0, 0, false,
+                0, BENCH_HEIGHT, 0, BENCH_WIDTH, false, 0, 0);
+        }
+        best = min(best, nowMs() - start);
+    }
+    return best;
+}
+
+/** Best of BENCH_REPEATS in ms for one task of shape, with the reference loop if formula is 0 */
+static double benchShape(const BenchShape *shape, const Formula *formula, Precision precision, fracInt *target, const BenchView *view) {
+    double pixelStep = view->zoom * 2 / min(BENCH_WIDTH, BENCH_HEIGHT);
+    double best = 1e30;
+    for (int i = 0; i < BENCH_REPEATS; i++) {
+        double start = nowMs();
+        if (formula) {
+            formula->calculate[precision](target, BENCH_MAX_ITERS, formula->paramR, formula->paramI,
+                view->offsetX, view->offsetY, pixelStep, BENCH_WIDTH, BENCH_HEIGHT,
+                shape->hstriping, 0, shape->hfillIn, 0, 0, false,
+                0, BENCH_HEIGHT, 0, shape->r1xEnd, shape->region2, shape->r2xStart, BENCH_WIDTH);
+        } else {
+            calculateReference(target, BENCH_MAX_ITERS, view->offsetX, view->offsetY, pixelStep, BENCH_WIDTH, BENCH_HEIGHT,
+                shape->hstriping, 0, shape->hfillIn, 0, 0, false,
+                0, BENCH_HEIGHT, 0, shape->r1xEnd, shape->region2, shape->r2xStart, BENCH_WIDTH);
+        }
+        best = min(best, nowMs() - start);
+    }
+    return best;
+}
+
+static void report(const char *kernel, const char *view, double ms, uint64_t iters) {
+    double pixels = (double)BENCH_WIDTH * BENCH_HEIGHT;
+    printf("%-14s %-12s %9.2fms %8.2f Mpx/s %8.1f Miter/s\n", kernel, view, ms, pixels / ms / 1000, iters / ms / 1000);
+}
+
+/**
+ * Single threaded kernel throughput on fixed views.
+ * Mandelbrot is run against the pre-formula reference loop to show the formula dispatch costs nothing per pixel,
+ * and per task shape against the same loop to show the specialized row loops cost nothing either.
+ */
+int main(int argc, char **argv) {
+    QueryPerformanceFrequency(&perfFrequency);
+    int count = BENCH_WIDTH * BENCH_HEIGHT;
+    fracInt *target = malloc(count * sizeof(fracInt));
+    fracInt *reference = malloc(count * sizeof(fracInt));
+
+    printf("Mandelbrot vs reference loop, %dx%d, maxIters %d\n", BENCH_WIDTH, BENCH_HEIGHT, BENCH_MAX_ITERS);
+    for (size_t i = 0; i < sizeof(views) / sizeof(views[0]); i++) {
+        const BenchView *view = views + i;
+        double referenceMs = benchKernel(0, 0, reference, view->offsetX, view->offsetY, view->zoom);
+        double kernelMs = benchKernel(&formulas[FORMULA_MANDELBROT], PRECISION_DOUBLE, target, view->offsetX, view->offsetY, view->zoom);
+        uint64_t iters = sumIters(target, count);
+        report("reference", view->name, referenceMs, iters);
+        report("Mandelbrot", view->name, kernelMs, iters);
+        printf("%-14s %-12s %9.3fx%s\n", "ratio", view->name, referenceMs / kernelMs,
+            memcmp(target, reference, count * sizeof(fracInt)) ? " OUTPUT DIFFERS" : "");
+    }
+
+    printf("\nFormulas at their initial views\n");
+    for (int i = 0; i < FORMULA_COUNT; i++) {
+        const Formula *formula = &formulas[i];
+        double ms = benchKernel(formula, PRECISION_DOUBLE, target, formula->offsetX, formula->offsetY, formula->zoom);
+        report(formula->name, "initial", ms, sumIters(target, count));
+    }
+
+    printf("\nMandelbrot precision tiers, pixels differing from double\n");
+    for (size_t i = 0; i < sizeof(views) / sizeof(views[0]); i++) {
+        const BenchView *view = views + i;
+        double pixelStep = view->zoom * 2 / min(BENCH_WIDTH, BENCH_HEIGHT);
+        bool exhausted;
+        Precision chosen = choosePrecision(&formulas[FORMULA_MANDELBROT], BENCH_MAX_ITERS,
+            view->offsetX, view->offsetY, pixelStep, BENCH_WIDTH, BENCH_HEIGHT, &exhausted);
+        benchKernel(&formulas[FORMULA_MANDELBROT], PRECISION_DOUBLE, reference, view->offsetX, view->offsetY, view->zoom);
+        for (Precision precision = PRECISION_FLOAT; precision < PRECISION_COUNT; precision++) {
+            double ms = benchKernel(&formulas[FORMULA_MANDELBROT], precision, target, view->offsetX, view->offsetY, view->zoom);
+            int differing = 0;
+            for (int p = 0; p < count; p++) {
+                if (target[p] != reference[p]) differing++;
+            }
+            report(precisionNames[precision], view->name, ms, sumIters(target, count));
+            printf("%-14s %-12s %8.3f%% differ%s\n", "", "", 100.0 * differing / count,
+                precision == chosen ? " (chosen)" : "");
+        }
+    }
+
+    printf("\nMandelbrot task shapes vs reference loop, ns per computed pixel\n");
+    const BenchView *shapeViews[] = { &views[EXTERIOR_VIEW], &views[1] };
+    for (size_t i = 0; i < sizeof(shapeViews) / sizeof(shapeViews[0]); i++) {
+        for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+            // Striped shapes leave pixels untouched, which have to match too
+            memset(reference, 0, count * sizeof(fracInt));
+            double referenceMs = benchShape(&shapes[s], 0, 0, reference, shapeViews[i]);
+            printf("%-14s %-12s reference %7.2fns", shapes[s].name, shapeViews[i]->name, referenceMs * 1e6 / shapes[s].computed);
+            double doubleMs = 0;
+            bool differs = false;
+            for (Precision precision = PRECISION_FLOAT; precision < PRECISION_COUNT; precision++) {
+                memset(target, 0, count * sizeof(fracInt));
+                double ms = benchShape(&shapes[s], &formulas[FORMULA_MANDELBROT], precision, target, shapeViews[i]);
+                printf(" %8s %7.2fns", precisionNames[precision], ms * 1e6 / shapes[s].computed);
+                if (precision == PRECISION_DOUBLE) {
+                    doubleMs = ms;
+                    differs = memcmp(target, reference, count * sizeof(fracInt)) != 0;
+                }
+            }
+            printf(" %6.3fx%s\n", referenceMs / doubleMs, differs ? " OUTPUT DIFFERS" : "");
+        }
+    }
+
+    free(target);
+    free(reference);
+    return 0;
+}
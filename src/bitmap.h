@@ -0,0 +1,36 @@
+#pragma once
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdint.h>
+
+/** Headers of a 32 bit bitmap of width x height with the top row first */
+static inline void bitmapHeaders(BITMAPFILEHEADER *fileHeader, BITMAPINFOHEADER *infoHeader, int width, int height) {
+    *fileHeader = (BITMAPFILEHEADER){ 0 };
+    *infoHeader = (BITMAPINFOHEADER){ 0 };
+    fileHeader->bfType = 0x4D42;
+    fileHeader->bfOffBits = sizeof(*fileHeader) + sizeof(*infoHeader);
+    fileHeader->bfSize = fileHeader->bfOffBits + width * height * sizeof(uint32_t);
+    infoHeader->biSize = sizeof(*infoHeader);
+    infoHeader->biWidth = width;
+    // Top-down rows, same as the window's DIB section
+    infoHeader->biHeight = -height;
+    infoHeader->biPlanes = 1;
+    infoHeader->biBitCount = 32;
+    infoHeader->biCompression = BI_RGB;
+}
+
+/** Writes pixels (0x00RRGGBB, top row first) as a 32 bit bitmap, returns 0 on success */
+static inline int writeBitmap(const char *path, const uint32_t *pixels, int width, int height) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return 1;
+    BITMAPFILEHEADER fileHeader;
+    BITMAPINFOHEADER infoHeader;
+    bitmapHeaders(&fileHeader, &infoHeader, width, height);
+    fwrite(&fileHeader, sizeof(fileHeader), 1, file);
+    fwrite(&infoHeader, sizeof(infoHeader), 1, file);
+    fwrite(pixels, sizeof(uint32_t), width * height, file);
+    int result = ferror(file) ? 1 : 0;
+    if (fclose(file) != 0) result = 1;
+    return result;
+}
@@ -0,0 +1,144 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "renderer.h"
+#include "bitmap.h"
+
+#define DEFAULT_MILLIONS 10
+#define DEFAULT_ROUNDS 10
+#define DEFAULT_MIN_ITERS 20
+#define DEFAULT_MAX_ITERS 1000
+
+#define DENSITY_MAGIC "FRBD"
+#define DENSITY_VERSION 1
+
+/** State file: this header followed by width * height uint64_t hits */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t minIters;
+    uint32_t maxIters;
+    uint32_t anti;
+    uint32_t reserved;
+    double centerX;
+    double centerY;
+    double pixelStep;
+    uint64_t samples;
+} DensityFileHeader;
+
+/** Written to a temporary file first, so that stopping mid-write keeps the last state */
+int saveDensity(const char *path, const DensityRender *density) {
+    char tempPath[MAX_PATH];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+    FILE *file = fopen(tempPath, "wb");
+    if (!file) return 1;
+    DensityFileHeader header = { 0 };
+    memcpy(header.magic, DENSITY_MAGIC, 4);
+    header.version = DENSITY_VERSION;
+    header.width = density->width;
+    header.height = density->height;
+    header.minIters = density->minIters;
+    header.maxIters = density->maxIters;
+    header.anti = density->anti;
+    header.centerX = density->centerX;
+    header.centerY = density->centerY;
+    header.pixelStep = density->pixelStep;
+    header.samples = density->samples;
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(density->histogram, sizeof(uint64_t), (size_t)density->width * density->height, file);
+    int result = ferror(file) ? 1 : 0;
+    if (fclose(file) != 0) result = 1;
+    if (result || !MoveFileExA(tempPath, path, MOVEFILE_REPLACE_EXISTING)) return 1;
+    return 0;
+}
+
+/** Continues from the state at path if it was sampled with the same view and limits */
+bool loadDensity(const char *path, DensityRender *density) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+    DensityFileHeader header;
+    bool loaded = fread(&header, sizeof(header), 1, file) == 1
+        && memcmp(header.magic, DENSITY_MAGIC, 4) == 0 && header.version == DENSITY_VERSION
+        && header.width == density->width && header.height == density->height
+        && header.minIters == density->minIters && header.maxIters == density->maxIters && header.anti == density->anti
+        && header.centerX == density->centerX && header.centerY == density->centerY && header.pixelStep == density->pixelStep
+        && fread(density->histogram, sizeof(uint64_t), (size_t)density->width * density->height, file)
+            == (size_t)density->width * density->height;
+    fclose(file);
+    if (loaded) {
+        density->samples = header.samples;
+    } else {
+        memset(density->histogram, 0, (size_t)density->width * density->height * sizeof(uint64_t));
+    }
+    return loaded;
+}
+
+/**
+ * Renders the orbit density of the Mandelbrot set in rounds, writing the bitmap and the sampling state after each,
+ * so the image can be watched while it builds up and a later run with the same arguments continues sampling.
+ */
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: buddha <file.bmp> <width> <height> [million samples per round] [rounds] [threads] [-anti]\n");
+        return 1;
+    }
+    const char *path = argv[1];
+    int width = atoi(argv[2]);
+    int height = atoi(argv[3]);
+    double millions = argc > 4 ? atof(argv[4]) : DEFAULT_MILLIONS;
+    int rounds = argc > 5 ? atoi(argv[5]) : DEFAULT_ROUNDS;
+    unsigned int threadCount = argc > 6 ? atoi(argv[6]) : 0;
+    bool anti = argc > 7 && strcmp(argv[7], "-anti") == 0;
+    if (width < 1 || height < 1 || millions <= 0 || rounds < 1) {
+        fprintf(stderr, "Invalid size, samples or rounds\n");
+        return 1;
+    }
+
+    if (rendererInitialize(threadCount)) {
+        fprintf(stderr, "Error initializing renderer\n");
+        rendererExit();
+        return 1;
+    }
+
+    // The whole set
+    DensityRender density = {
+        .width = width, .height = height,
+        .centerX = -0.4, .centerY = 0, .pixelStep = 3.0 / min(width, height),
+        .minIters = anti ? 0 : DEFAULT_MIN_ITERS, .maxIters = anti ? DEFAULT_MAX_ITERS / 20 : DEFAULT_MAX_ITERS,
+        .anti = anti,
+    };
+    density.histogram = malloc((size_t)width * height * sizeof(uint64_t));
+    char statePath[MAX_PATH];
+    snprintf(statePath, sizeof(statePath), "%s.density", path);
+    if (loadDensity(statePath, &density))
+        printf("Resuming %s after %.1f million samples\n", statePath, density.samples / 1e6);
+
+    uint32_t *pixels = malloc((size_t)width * height * sizeof(uint32_t));
+    uint64_t samples = (uint64_t)(millions * 1e6);
+    int result = 0;
+    for (int round = 0; round < rounds && !result; round++) {
+        DensityStats stats = renderDensity(&density, samples);
+        double perCore = stats.samples / (stats.sampleMs / 1000) / rendererThreadCount();
+        printf("Round %d: %.1fM samples in %.0fms, %.2fM samples/s per thread, %.1f%% skipped as interior, "
+            "%.2f%% recorded, merge %.1fms (%.1f%%)\n",
+            round + 1, stats.samples / 1e6, stats.sampleMs, perCore / 1e6, 100.0 * stats.skipped / stats.samples,
+            100.0 * stats.recorded / stats.samples, stats.mergeMs, 100 * stats.mergeMs / (stats.sampleMs + stats.mergeMs));
+
+        densityColors(&density, pixels);
+        result = writeBitmap(path, pixels, width, height);
+        if (result) fprintf(stderr, "Error writing %s\n", path);
+        if (saveDensity(statePath, &density)) {
+            fprintf(stderr, "Error writing %s\n", statePath);
+            result = 1;
+        }
+    }
+    printf("%.1f million samples in total\n", density.samples / 1e6);
+    free(pixels);
+    free(density.histogram);
+    rendererExit();
+    return result;
+}
@@ -0,0 +1,93 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "renderer.h"
+#include "iterfile.h"
+
+#define DEFAULT_STEPS 4
+/** Same as the renderer */
+#define FIRST_MAX_ITERS 1000
+
+/**
+ * Renders a formula's initial view with the renderer's iteration limit, then raises the limit in steps up to
+ * a maximum, continuing only the pixels that had not escaped yet. Every step is checked against and timed
+ * with a full render at the new limit. The iterations at the last limit are written for recolor.
+ */
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        fprintf(stderr, "Usage: deepen <file.iter> <width> <height> <max iterations> [steps] [threads] [formula]\n");
+        return 1;
+    }
+    const char *path = argv[1];
+    int width = atoi(argv[2]);
+    int height = atoi(argv[3]);
+    int lastIters = atoi(argv[4]);
+    int steps = argc > 5 ? atoi(argv[5]) : DEFAULT_STEPS;
+    unsigned int threadCount = argc > 6 ? atoi(argv[6]) : 0;
+    // 1-based like the viewer's number keys
+    int formulaIndex = argc > 7 ? atoi(argv[7]) - 1 : FORMULA_MANDELBROT;
+    if (width < 1 || height < 1 || formulaIndex < 0 || formulaIndex >= FORMULA_COUNT) {
+        fprintf(stderr, "Invalid size or formula\n");
+        return 1;
+    }
+    if (lastIters <= FIRST_MAX_ITERS || lastIters > UINT16_MAX || steps < 1) {
+        fprintf(stderr, "Maximum iterations must be above %d and at most %d, with at least one step\n",
+            FIRST_MAX_ITERS, UINT16_MAX);
+        return 1;
+    }
+
+    if (rendererInitialize(threadCount)) {
+        fprintf(stderr, "Error initializing renderer\n");
+        rendererExit();
+        return 1;
+    }
+
+    const Formula *formula = &formulas[formulaIndex];
+    size_t count = (size_t)width * height;
+    ResumableRender render = {
+        .formula = formula, .width = width, .height = height,
+        .centerX = formula->offsetX, .centerY = formula->offsetY, .pixelStep = formula->zoom * 2 / min(width, height),
+        .iterations = malloc(count * sizeof(fracInt)),
+    };
+    ResumableRender full = render;
+    full.iterations = malloc(count * sizeof(fracInt));
+
+    ResumeStats stats = renderResumable(&render, FIRST_MAX_ITERS);
+    printf("%s %dx%d: %d iterations in %.1fms, %d pixels (%.1f%%) still inside kept as %.1f MB\n",
+        formula->name, width, height, FIRST_MAX_ITERS, stats.ms, stats.inside, 100.0 * stats.inside / count,
+        stats.inside * sizeof(ResumePoint) / 1e6);
+
+    double resumedMs = 0, fullMs = 0;
+    int mismatches = 0;
+    for (int step = 1; step <= steps; step++) {
+        int maxIters = FIRST_MAX_ITERS + (int)((int64_t)(lastIters - FIRST_MAX_ITERS) * step / steps);
+        stats = renderResumable(&render, maxIters);
+        // From scratch for comparison
+        full.maxIters = 0;
+        ResumeStats fullStats = renderResumable(&full, maxIters);
+        resumableFree(&full);
+        int stepMismatches = 0;
+        for (size_t i = 0; i < count; i++)
+            stepMismatches += render.iterations[i] != full.iterations[i];
+        mismatches += stepMismatches;
+        resumedMs += stats.ms;
+        fullMs += fullStats.ms;
+        printf("%5d iterations: resumed %d pixels (%.1f%%) in %.1fms, full render %.1fms (%.2fx), %d still inside%s\n",
+            maxIters, stats.resumed, 100.0 * stats.resumed / count, stats.ms, fullStats.ms,
+            fullStats.ms / max(stats.ms, 0.001), stats.inside, stepMismatches ? ", DIFFERENT" : "");
+    }
+    printf("Raising to %d iterations took %.1fms resumed against %.1fms rerendered, %.1fms saved%s\n",
+        lastIters, resumedMs, fullMs, fullMs - resumedMs, mismatches ? ", results differ" : ", identical results");
+
+    IterFileHeader header = { .compression = ITER_RLE, .width = width, .height = height, .maxIters = render.maxIters,
+        .formula = formulaIndex, .centerX = render.centerX, .centerY = render.centerY, .pixelStep = render.pixelStep };
+    int result = writeIterations(path, header, render.iterations);
+    if (result) fprintf(stderr, "Error writing %s\n", path);
+    resumableFree(&render);
+    free(render.iterations);
+    free(full.iterations);
+    rendererExit();
+    return result || mismatches ? 1 : 0;
+}
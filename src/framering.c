@@ -0,0 +1,96 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "framering.h"
+
+struct FrameRing {
+    HANDLE mapping;
+    FrameRingHeader *header;
+    /** Frame being written, 0 when none */
+    uint64_t writing;
+};
+
+FrameRing *frameRingCreate(const char *name, int maxWidth, int maxHeight, uint32_t flags) {
+    if (maxWidth <= 0 || maxHeight <= 0 || !(flags & (FRAME_RING_ITERS | FRAME_RING_BGRA))) return 0;
+    uint64_t pixels = (uint64_t)maxWidth * maxHeight;
+    uint64_t slotBytes = FRAME_RING_ROUND(sizeof(FrameSlotHeader))
+        + (flags & FRAME_RING_ITERS ? FRAME_RING_ROUND(pixels * sizeof(fracInt)) : 0)
+        + (flags & FRAME_RING_BGRA ? FRAME_RING_ROUND(pixels * sizeof(uint32_t)) : 0);
+    uint64_t size = FRAME_RING_ROUND(sizeof(FrameRingHeader)) + FRAME_RING_SLOTS * slotBytes;
+
+    // Backed by the paging file, so the pages are shared with readers and never written to disk
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+        (DWORD)(size >> 32), (DWORD)size, name);
+    if (!mapping) return 0;
+    FrameRingHeader *header = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!header) {
+        CloseHandle(mapping);
+        return 0;
+    }
+
+    // Readers check magic last, a mapping left over from an earlier run is invalid until it is set again
+    memset(header->magic, 0, sizeof(header->magic));
+    MemoryBarrier();
+    header->version = FRAME_RING_VERSION;
+    header->flags = flags;
+    header->slotCount = FRAME_RING_SLOTS;
+    header->maxWidth = maxWidth;
+    header->maxHeight = maxHeight;
+    header->slotBytes = slotBytes;
+    header->published = 0;
+    header->oversized = 0;
+    for (uint64_t frame = 0; frame < FRAME_RING_SLOTS; frame++)
+        frameRingSlot(header, frame)->sequence = 0;
+    MemoryBarrier();
+    memcpy(header->magic, FRAME_RING_MAGIC, 4);
+
+    FrameRing *ring = calloc(1, sizeof(FrameRing));
+    ring->mapping = mapping;
+    ring->header = header;
+    return ring;
+}
+
+void frameRingClose(FrameRing *ring) {
+    if (!ring) return;
+    UnmapViewOfFile(ring->header);
+    CloseHandle(ring->mapping);
+    free(ring);
+}
+
+const FrameRingHeader *frameRingHeader(const FrameRing *ring) {
+    return ring->header;
+}
+
+FrameSlotHeader *frameRingBegin(FrameRing *ring, int width, int height) {
+    FrameRingHeader *header = ring->header;
+    if (width <= 0 || height <= 0 || width > header->maxWidth || height > header->maxHeight) {
+        header->oversized++;
+        return 0;
+    }
+    ring->writing = header->published + 1;
+    FrameSlotHeader *slot = frameRingSlot(header, ring->writing);
+    slot->sequence = 2 * ring->writing - 1;
+    MemoryBarrier();
+    slot->width = width;
+    slot->height = height;
+    // Padding between the iterations and BGRA data is part of the checksum
+    if (header->flags & FRAME_RING_ITERS) {
+        size_t itersBytes = (size_t)width * height * sizeof(fracInt);
+        memset((uint8_t*)frameSlotIters(slot) + itersBytes, 0, FRAME_RING_ROUND(itersBytes) - itersBytes);
+    }
+    return slot;
+}
+
+void frameRingPublish(FrameRing *ring, FrameSlotHeader *slot) {
+    FrameRingHeader *header = ring->header;
+    slot->checksum = frameRingChecksum(frameSlotIters(slot), frameSlotDataBytes(header, slot));
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    slot->time = now.QuadPart;
+    MemoryBarrier();
+    slot->sequence = 2 * ring->writing;
+    header->published = ring->writing;
+    ring->writing = 0;
+}
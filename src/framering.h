@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mandelbrot.h"
+
+#define FRAME_RING_MAGIC "FRFR"
+#define FRAME_RING_VERSION 1
+/** Frames kept in the ring, a consumer this many frames behind starts missing frames */
+#define FRAME_RING_SLOTS 4
+/** Slot headers and data start cache line aligned */
+#define FRAME_RING_ALIGN 64
+
+/** FrameRingHeader.flags: which data every slot holds, iterations come first */
+#define FRAME_RING_ITERS 1
+#define FRAME_RING_BGRA 2
+
+/** FrameSlotHeader.flags */
+#define FRAME_SLOT_COMPLETE 1
+
+/**
+ * Named shared memory layout: FrameRingHeader padded to FRAME_RING_ALIGN,
+ * then slotCount slots of slotBytes each. A slot is FrameSlotHeader padded to FRAME_RING_ALIGN,
+ * then width * height fracInt if FRAME_RING_ITERS, then width * height BGRA uint32_t if FRAME_RING_BGRA,
+ * the BGRA data starting FRAME_RING_ALIGN aligned.
+ * Frame n (counted from 1) is written to slot n % slotCount.
+ */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t slotCount;
+    uint32_t maxWidth;
+    uint32_t maxHeight;
+    uint64_t slotBytes;
+    /** Last frame completely written, readers poll this */
+    volatile uint64_t published;
+    /** Frames that did not fit maxWidth x maxHeight and were not written */
+    volatile uint64_t oversized;
+} FrameRingHeader;
+
+/**
+ * sequence is 2n - 1 while frame n is being written and 2n once it is written,
+ * a reader that sees the same even sequence before and after reading got an untorn frame.
+ * Pixel (px, py) lies at centerX + pixelStep * (px - width / 2), centerY + pixelStep * (py - height / 2)
+ * with integer division.
+ */
+typedef struct {
+    volatile uint64_t sequence;
+    uint32_t width;
+    uint32_t height;
+    uint32_t flags;
+    /** Index into formulas */
+    uint32_t formula;
+    uint32_t maxIters;
+    /** Progressive passes calculated, see renderer.c */
+    uint32_t passesDone;
+    double centerX;
+    double centerY;
+    double pixelStep;
+    /** QueryPerformanceCounter when the frame was published */
+    int64_t time;
+    /** frameRingChecksum of the data following the header */
+    uint64_t checksum;
+} FrameSlotHeader;
+
+#define FRAME_RING_ROUND(bytes) (((bytes) + FRAME_RING_ALIGN - 1) / FRAME_RING_ALIGN * FRAME_RING_ALIGN)
+
+static inline FrameSlotHeader *frameRingSlot(const FrameRingHeader *header, uint64_t frame) {
+    return (FrameSlotHeader*)((uint8_t*)header + FRAME_RING_ROUND(sizeof(FrameRingHeader))
+        + frame % header->slotCount * header->slotBytes);
+}
+
+static inline fracInt *frameSlotIters(FrameSlotHeader *slot) {
+    return (fracInt*)((uint8_t*)slot + FRAME_RING_ROUND(sizeof(FrameSlotHeader)));
+}
+
+/** Valid when the ring has FRAME_RING_BGRA */
+static inline uint32_t *frameSlotPixels(const FrameRingHeader *header, FrameSlotHeader *slot) {
+    size_t itersBytes = header->flags & FRAME_RING_ITERS
+        ? FRAME_RING_ROUND((size_t)slot->width * slot->height * sizeof(fracInt)) : 0;
+    return (uint32_t*)((uint8_t*)frameSlotIters(slot) + itersBytes);
+}
+
+/** Bytes of data following the slot header, including the padding before the BGRA data */
+static inline size_t frameSlotDataBytes(const FrameRingHeader *header, const FrameSlotHeader *slot) {
+    size_t pixels = (size_t)slot->width * slot->height;
+    return (header->flags & FRAME_RING_ITERS ? FRAME_RING_ROUND(pixels * sizeof(fracInt)) : 0)
+        + (header->flags & FRAME_RING_BGRA ? pixels * sizeof(uint32_t) : 0);
+}
+
+/** Fletcher style sum of 32 bit words, cheap enough to run over every frame */
+static inline uint64_t frameRingChecksum(const void *data, size_t bytes) {
+    const uint32_t *words = data;
+    uint64_t sum = 0, sumOfSums = 0;
+    for (size_t i = 0; i < bytes / 4; i++) {
+        sum += words[i];
+        sumOfSums += sum;
+    }
+    return sum ^ sumOfSums << 32 ^ sumOfSums >> 32;
+}
+
+typedef struct FrameRing FrameRing;
+
+/** Creates the named mapping for frames up to maxWidth x maxHeight, returns 0 on failure */
+FrameRing *frameRingCreate(const char *name, int maxWidth, int maxHeight, uint32_t flags);
+void frameRingClose(FrameRing *ring);
+const FrameRingHeader *frameRingHeader(const FrameRing *ring);
+/**
+ * Starts writing the next frame and returns its slot with the size set, fill in the rest and the data,
+ * then call frameRingPublish. Returns 0 if the frame is larger than the ring, it is counted as oversized.
+ */
+FrameSlotHeader *frameRingBegin(FrameRing *ring, int width, int height);
+/** Sets the checksum and makes the frame visible to readers */
+void frameRingPublish(FrameRing *ring, FrameSlotHeader *slot);
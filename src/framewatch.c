@@ -0,0 +1,111 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "framering.h"
+
+#define DEFAULT_RING_NAME "brotFrames"
+#define DEFAULT_SECONDS 10
+/** How long to wait for the viewer to create the ring */
+#define OPEN_TIMEOUT_MS 10000
+
+/**
+ * Reference reader of the frame ring published by the viewer.
+ * Frames are checked in place in the shared memory without copying them,
+ * every second it prints how many frames and bytes got through and how many were missed.
+ */
+int main(int argc, char **argv) {
+    const char *name = argc > 1 ? argv[1] : DEFAULT_RING_NAME;
+    int seconds = argc > 2 ? atoi(argv[2]) : DEFAULT_SECONDS;
+
+    HANDLE mapping = 0;
+    for (int waited = 0; !(mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name)) && waited < OPEN_TIMEOUT_MS; waited += 100)
+        Sleep(100);
+    if (!mapping) {
+        fprintf(stderr, "Frame ring %s not found\n", name);
+        return 1;
+    }
+    const FrameRingHeader *header = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!header || memcmp(header->magic, FRAME_RING_MAGIC, 4) != 0 || header->version != FRAME_RING_VERSION
+        || header->slotCount == 0) {
+        fprintf(stderr, "Invalid frame ring %s\n", name);
+        return 1;
+    }
+    printf("Frame ring %s: %d slots of %dx%d,%s%s\n", name, header->slotCount, header->maxWidth, header->maxHeight,
+        header->flags & FRAME_RING_ITERS ? " iterations" : "", header->flags & FRAME_RING_BGRA ? " BGRA" : "");
+
+    LARGE_INTEGER perfFrequency, perfStart, perfReport, perfNow;
+    QueryPerformanceFrequency(&perfFrequency);
+    QueryPerformanceCounter(&perfStart);
+    perfReport = perfStart;
+
+    // Totals and the counts since the last report
+    uint64_t frames = 0, bytes = 0, missed = 0, torn = 0, corrupt = 0, incomplete = 0;
+    uint64_t reportFrames = 0, reportBytes = 0, reportMissed = 0;
+    double reportLatency = 0;
+    FrameSlotHeader last = { 0 };
+    uint64_t next = header->published + 1;
+    while (true) {
+        QueryPerformanceCounter(&perfNow);
+        if ((perfNow.QuadPart - perfReport.QuadPart) >= perfFrequency.QuadPart) {
+            double elapsed = (double)(perfNow.QuadPart - perfReport.QuadPart) / perfFrequency.QuadPart;
+            printf("%.1f frames/s, %.1f MB/s, %.2fms latency, %d missed, %d torn, %d corrupt, last %dx%d at (%g, %g) step %g%s\n",
+                reportFrames / elapsed, reportBytes / elapsed / 1e6, reportFrames ? reportLatency / reportFrames : 0,
+                (int)reportMissed, (int)torn, (int)corrupt, last.width, last.height,
+                last.centerX, last.centerY, last.pixelStep, last.flags & FRAME_SLOT_COMPLETE ? "" : " (incomplete)");
+            reportFrames = reportBytes = reportMissed = 0;
+            reportLatency = 0;
+            perfReport = perfNow;
+            if (perfNow.QuadPart - perfStart.QuadPart >= (int64_t)seconds * perfFrequency.QuadPart) break;
+        }
+
+        uint64_t published = header->published;
+        if (next > published) {
+            Sleep(1);
+            continue;
+        }
+        // The writer went round the ring since, older frames are overwritten
+        if (published - next >= header->slotCount) {
+            uint64_t oldest = published - header->slotCount + 1;
+            missed += oldest - next;
+            reportMissed += oldest - next;
+            next = oldest;
+        }
+
+        FrameSlotHeader *slot = frameRingSlot(header, next);
+        uint64_t sequence = slot->sequence;
+        MemoryBarrier();
+        FrameSlotHeader meta = *slot;
+        bool valid = sequence == 2 * next && meta.width <= header->maxWidth && meta.height <= header->maxHeight;
+        uint64_t checksum = valid ? frameRingChecksum(frameSlotIters(slot), frameSlotDataBytes(header, &meta)) : 0;
+        MemoryBarrier();
+        // Overwritten before or while reading it
+        if (!valid || slot->sequence != sequence) {
+            if (sequence == 2 * next) torn++;
+            missed++;
+            reportMissed++;
+            next++;
+            continue;
+        }
+        next++;
+        if (checksum != meta.checksum || meta.formula >= FORMULA_COUNT || !(meta.pixelStep > 0)) {
+            corrupt++;
+            continue;
+        }
+        QueryPerformanceCounter(&perfNow);
+        frames++;
+        reportFrames++;
+        bytes += frameSlotDataBytes(header, &meta);
+        reportBytes += frameSlotDataBytes(header, &meta);
+        reportLatency += (double)(perfNow.QuadPart - meta.time) * 1000 / perfFrequency.QuadPart;
+        if (!(meta.flags & FRAME_SLOT_COMPLETE)) incomplete++;
+        last = meta;
+    }
+
+    printf("%d frames (%d incomplete), %.1f MB, %d missed (%d torn), %d corrupt, %d too large for the ring\n",
+        (int)frames, (int)incomplete, bytes / 1e6, (int)missed, (int)torn, (int)corrupt, (int)header->oversized);
+    UnmapViewOfFile(header);
+    CloseHandle(mapping);
+    return corrupt ? 1 : 0;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mandelbrot.h"
+
+#define ITER_MAGIC "FRIT"
+#define ITER_VERSION 1
+
+/** How rows are stored */
+typedef enum {
+    /** width fracInt */
+    ITER_RAW,
+    /** IterRun pairs whose counts add up to width, large uniform regions take a few bytes per row */
+    ITER_RLE,
+} IterCompression;
+
+/**
+ * Raw iteration counts of a render, independent of any palette.
+ * File layout: IterFileHeader, uint64_t rowOffsets[height + 1] with the byte offset of every row from the start
+ * of the file and the end of the last one, then the rows. Rows can be decoded on their own, so readers can split them.
+ * Pixel (px, py) lies at centerX + pixelStep * (px - width / 2), same for y.
+ */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    /** Size of one iteration count, sizeof(fracInt) */
+    uint32_t elementBytes;
+    uint32_t compression;
+    uint32_t width;
+    uint32_t height;
+    /** Pixels that did not escape hold maxIters */
+    uint32_t maxIters;
+    /** Index into formulas */
+    uint32_t formula;
+    double centerX;
+    double centerY;
+    double pixelStep;
+} IterFileHeader;
+
+typedef struct {
+    uint16_t count;
+    fracInt value;
+} IterRun;
+
+/** End of the run of equal values starting at x, no longer than a run can count */
+static inline int iterRunEnd(const fracInt *row, int width, int x) {
+    int end = x + 1;
+    while (end < width && row[end] == row[x] && end - x < UINT16_MAX) end++;
+    return end;
+}
+
+/** Bytes a row takes with compression */
+static inline uint64_t iterRowBytes(const fracInt *row, int width, IterCompression compression) {
+    if (compression == ITER_RAW) return (uint64_t)width * sizeof(fracInt);
+    uint64_t runs = 0;
+    for (int x = 0; x < width; runs++) x = iterRunEnd(row, width, x);
+    return runs * sizeof(IterRun);
+}
+
+/** Writes width x height iterations with the view in header, filling in the layout fields. Returns 0 on success */
+static inline int writeIterations(const char *path, IterFileHeader header, const fracInt *iterations) {
+    memcpy(header.magic, ITER_MAGIC, 4);
+    header.version = ITER_VERSION;
+    header.elementBytes = sizeof(fracInt);
+    FILE *file = fopen(path, "wb");
+    if (!file) return 1;
+
+    // Row sizes first so that the offsets come before the rows
+    uint64_t *rowOffsets = malloc((header.height + 1) * sizeof(uint64_t));
+    rowOffsets[0] = sizeof(header) + (header.height + 1) * sizeof(uint64_t);
+    for (uint32_t y = 0; y < header.height; y++)
+        rowOffsets[y + 1] = rowOffsets[y] + iterRowBytes(iterations + (size_t)y * header.width, header.width, header.compression);
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(rowOffsets, sizeof(uint64_t), header.height + 1, file);
+    free(rowOffsets);
+
+    IterRun *runs = malloc(header.width * sizeof(IterRun));
+    for (uint32_t y = 0; y < header.height; y++) {
+        const fracInt *row = iterations + (size_t)y * header.width;
+        if (header.compression == ITER_RAW) {
+            fwrite(row, sizeof(fracInt), header.width, file);
+            continue;
+        }
+        int count = 0;
+        for (int x = 0; x < (int)header.width; count++) {
+            int end = iterRunEnd(row, header.width, x);
+            runs[count] = (IterRun){ end - x, row[x] };
+            x = end;
+        }
+        fwrite(runs, sizeof(IterRun), count, file);
+    }
+    free(runs);
+    int result = ferror(file) ? 1 : 0;
+    if (fclose(file) != 0) result = 1;
+    return result;
+}
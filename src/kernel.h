@@ -0,0 +1,358 @@
+/**
+ * calculate() body shared by all formulas, included once per formula and precision through tiers.h.
+ * Before including define:
+ * KERNEL_FUNCTION - name of the generated function
+ * KERNEL_REAL     - float, double or long double the pixel loop computes in
+ * KERNEL_LANES    - pixels iterated together in a vector, 1 for plain scalar code
+ * KERNEL_LANE_INT - integer as wide as KERNEL_REAL, for vector comparison masks
+ * KERNEL_START    - sets the starting z (cr, ci) for pixel coordinates (x, y), KERNEL_ZERO is zero of their type
+ * KERNEL_ITERATE  - advances z (cr, ci) by one iteration, may use x, y, paramCr and paramCi,
+ *                   temporaries are declared as KERNEL_VALUE since they may be vectors
+ * KERNEL_RESUME   - optional, name of the ResumeKernel to generate alongside
+ * The formula is inlined into its own pixel loop, so no formula has to branch on which formula it is.
+ * Likewise every task shape (plain rectangle, striped, striped with fill-in, two regions) gets its own
+ * copy of the row loop, KERNEL_FUNCTION picks one per call and the pixel loop never checks the shape.
+ */
+
+#define KERNEL_SPAN KERNEL_CONCAT(KERNEL_FUNCTION, Span)
+#define KERNEL_ROWS KERNEL_CONCAT(KERNEL_FUNCTION, Rows)
+#define KERNEL_CONTINUE KERNEL_CONCAT(KERNEL_FUNCTION, Continue)
+
+#if KERNEL_LANES > 1
+/**
+ * Continues count pixels pxs[i] of row from z (crs[i], cis[i]) after fromIters iterations, KERNEL_LANES of them
+ * per vector, each also written over the fillWidth - 1 pixels right of it below pxEnd.
+ * Out of line so that the scalar loop every pixel goes through stays small.
+ */
+static __attribute__((noinline)) void KERNEL_CONTINUE(
+    fracInt *row, const int *pxs, const KERNEL_REAL *xs, const KERNEL_REAL *crs, const KERNEL_REAL *cis, int count,
+    KERNEL_REAL rowY, int fromIters, int maxIters, KERNEL_REAL paramCr, KERNEL_REAL paramCi, int fillWidth, int pxEnd
+) {
+    (void)paramCr; (void)paramCi;
+    int i = 0;
+    typedef KERNEL_REAL KernelVector __attribute__((vector_size(sizeof(KERNEL_REAL) * KERNEL_LANES)));
+    // Comparisons give -1 for true lanes
+    typedef KERNEL_LANE_INT KernelMask __attribute__((vector_size(sizeof(KERNEL_REAL) * KERNEL_LANES)));
+#define KERNEL_VALUE KernelVector
+#define KERNEL_ZERO ((KernelVector){ 0 })
+    for (; i + KERNEL_LANES <= count; i += KERNEL_LANES) {
+        KernelVector x, y = rowY + (KernelVector){ 0 };
+        KernelVector cr, ci;
+        (void)x; (void)y;
+        for (int lane = 0; lane < KERNEL_LANES; lane++) {
+            x[lane] = xs[i + lane];
+            cr[lane] = crs[i + lane];
+            ci[lane] = cis[i + lane];
+        }
+        // Escaped lanes keep iterating until all have escaped, only inside lanes count
+        KernelMask iters = (KernelMask){ 0 } + fromIters;
+        for (int n = fromIters; n < maxIters; n++) {
+            KernelMask inside = (cr < 4) & (cr > -4) & (ci < 4) & (ci > -4);
+            bool anyInside = false;
+            for (int lane = 0; lane < KERNEL_LANES; lane++)
+                anyInside |= inside[lane] != 0;
+            if (!anyInside) break;
+            iters -= inside;
+            KERNEL_ITERATE
+        }
+        for (int lane = 0; lane < KERNEL_LANES; lane++)
+            row[pxs[i + lane]] = iters[lane];
+    }
+#undef KERNEL_VALUE
+#undef KERNEL_ZERO
+#define KERNEL_VALUE KERNEL_REAL
+#define KERNEL_ZERO 0
+    for (; i < count; i++) {
+        KERNEL_REAL x = xs[i], y = rowY;
+        KERNEL_REAL cr = crs[i], ci = cis[i];
+        (void)x; (void)y;
+        int iters = fromIters;
+        while (cr < 4 && cr > -4 && ci < 4 && ci > -4 && iters < maxIters) {
+            iters++;
+            KERNEL_ITERATE
+        }
+        row[pxs[i]] = iters;
+    }
+#undef KERNEL_VALUE
+#undef KERNEL_ZERO
+    for (i = 0; i < count && fillWidth > 1; i++) {
+        for (int destPx = pxs[i] + 1; destPx < pxs[i] + fillWidth && destPx < pxEnd; destPx++)
+            row[destPx] = row[pxs[i]];
+    }
+}
+#endif
+
+/**
+ * Calculates pixels pxStart, pxStart + xInc, ... below pxEnd of one row, pixel px at x columnX[px - pxStart], with fill
+ * also over the pixels skipped right of each. Filling as each pixel is written hides the stores behind the escape loop.
+ */
+static inline __attribute__((always_inline)) void KERNEL_SPAN(
+    fracInt *row, KERNEL_REAL rowY, int maxIters,
+    KERNEL_REAL paramCr, KERNEL_REAL paramCi, const KERNEL_REAL *columnX,
+    int pxStart, int pxEnd, const int xInc, const bool fill
+) {
+    (void)paramCr; (void)paramCi;
+#if KERNEL_LANES > 1
+    // Most pixels escape within a few iterations, vectors only pay off for the ones that don't
+    int scalarIters = maxIters < KERNEL_SCALAR_ITERS ? maxIters : KERNEL_SCALAR_ITERS;
+    // Pixels still inside after scalarIters, continued together once KERNEL_BATCH of them are gathered
+    int pending = 0;
+    int pendingPx[KERNEL_BATCH];
+    KERNEL_REAL pendingX[KERNEL_BATCH], pendingCr[KERNEL_BATCH], pendingCi[KERNEL_BATCH];
+#endif
+#define KERNEL_VALUE KERNEL_REAL
+#define KERNEL_ZERO 0
+    KERNEL_REAL y = rowY;
+    for (int px = pxStart; px < pxEnd; px += xInc) {
+        KERNEL_REAL x = columnX[px - pxStart];
+        // Real and Imaginary components
+        KERNEL_REAL cr, ci;
+        KERNEL_START
+        int iters = 0;
+        while (cr < 4 && cr > -4 && ci < 4 && ci > -4) {
+#if KERNEL_LANES > 1
+            if (iters == scalarIters) {
+                if (iters == maxIters) break;
+                // Goes into the next batch, which overwrites the iterations written below once it is done
+                if (pending == KERNEL_BATCH) {
+                    KERNEL_CONTINUE(row, pendingPx, pendingX, pendingCr, pendingCi, pending,
+                        rowY, scalarIters, maxIters, paramCr, paramCi, fill ? xInc : 1, pxEnd);
+                    pending = 0;
+                }
+                pendingPx[pending] = px;
+                pendingX[pending] = x;
+                pendingCr[pending] = cr;
+                pendingCi[pending] = ci;
+                pending++;
+                break;
+            }
+#else
+            if (iters == maxIters) break;
+#endif
+            iters++;
+            KERNEL_ITERATE
+        }
+        row[px] = iters;
+        if (fill) {
+            for (int destPx = px + 1; destPx < px + xInc && destPx < pxEnd; destPx++)
+                row[destPx] = iters;
+        }
+    }
+#undef KERNEL_VALUE
+#undef KERNEL_ZERO
+#if KERNEL_LANES > 1
+    if (pending) {
+        KERNEL_CONTINUE(row, pendingPx, pendingX, pendingCr, pendingCi, pending,
+            rowY, scalarIters, maxIters, paramCr, paramCi, fill ? xInc : 1, pxEnd);
+    }
+#endif
+}
+
+/** Row loop of every shape, the callers pass striped, fill and twoRegions as constants */
+static inline __attribute__((always_inline)) void KERNEL_ROWS(
+    KERNEL_PARAMETERS,
+    const bool striped, const bool fill, const bool twoRegions
+) {
+    KERNEL_REAL paramCr = paramR, paramCi = paramI;
+    int left   = -(int)floor((float)width / 2);
+    int top    = -(int)floor((float)height / 2);
+    int bottom = (int)ceil((float)height / 2);
+
+    int yInc = 1, xInc = 1;
+    short yStripeOffset = 0, r1xStripeOffset = 0, r2xStripeOffset = 0;
+    // Align starts with striping and offset (move right by as little as possible)
+    if (vstriping >= 2) {
+        yInc = vstriping;
+        yStripeOffset = (10000 * vstriping - (top + yStart) + vstripeOffset) % vstriping;
+    }
+    if (striped) {
+        xInc = hstriping;
+        r1xStripeOffset = (10000 * hstriping - (left + r1xStart) + hstripeOffset) % hstriping;
+        if (twoRegions)
+            r2xStripeOffset = (10000 * hstriping - (left + r2xStart) + hstripeOffset) % hstriping;
+    }
+    int r1xFirst = r1xStart + r1xStripeOffset, r2xFirst = r2xStart + r2xStripeOffset;
+
+    // Every row has the same pixel x, worked out once instead of per row. On the heap, a task can be as wide
+    // as a whole still, too wide for worker thread stacks. Room for xInc more, where a region's first pixel may be.
+    int columns = (twoRegions ? r2xEnd : r1xEnd) - r1xStart;
+    KERNEL_REAL *columnX = malloc(((columns > 0 ? columns : 0) + xInc) * sizeof(KERNEL_REAL));
+    for (int px = r1xFirst; px < r1xEnd; px += xInc)
+        columnX[px - r1xStart] = (KERNEL_REAL)centerX + (KERNEL_REAL)pixelStep * (left + px);
+    for (int px = r2xFirst; twoRegions && px < r2xEnd; px += xInc)
+        columnX[px - r1xStart] = (KERNEL_REAL)centerX + (KERNEL_REAL)pixelStep * (left + px);
+
+    fracInt *iter = target + (yStart + yStripeOffset) * width;
+    size_t rowStep = width * yInc;
+    for (
+        int iy = top + yStart + yStripeOffset, py = yStart + yStripeOffset, row = 0;
+        iy < bottom && py < yEnd;
+        iy += yInc, py += yInc, row++
+    ) {
+        KERNEL_REAL rowY = (KERNEL_REAL)centerY + (KERNEL_REAL)pixelStep * iy;
+
+        KERNEL_SPAN(iter, rowY, maxIters, paramCr, paramCi, columnX + (r1xFirst - r1xStart), r1xFirst, r1xEnd, xInc, fill);
+        if (twoRegions)
+            KERNEL_SPAN(iter, rowY, maxIters, paramCr, paramCi, columnX + (r2xFirst - r1xStart), r2xFirst, r2xEnd, xInc, fill);
+        if (fill) {
+            // Right of each pixel is filled by the span, fill left of the first pixel of each region
+            for (int px = r1xStart; px < r1xFirst && r1xFirst < r1xEnd; px++)
+                iter[px] = iter[r1xFirst];
+            if (twoRegions) {
+                for (int px = r2xStart; px < r2xFirst && r2xFirst < r2xEnd; px++)
+                    iter[px] = iter[r2xFirst];
+            }
+        }
+
+        // Fill in skipped stripes
+        if (vfillIn) {
+            size_t r1rowLength = (r1xEnd - r1xStart) * sizeof(fracInt);
+            size_t r2rowLength = (r2xEnd - r2xStart) * sizeof(fracInt);
+            // Fill above
+            if (row == 0 && yStripeOffset > 0) {
+                for (int filli = 1; filli <= yStripeOffset; filli++) {
+                    memcpy(iter - filli * width + r1xStart, iter + r1xStart, r1rowLength);
+                    if (twoRegions) memcpy(iter - filli * width + r2xStart, iter + r2xStart, r2rowLength);
+                }
+            }
+            // Fill below
+            fracInt *destIter = iter;
+            for (
+                int destPy = py + 1, destRow = 1;
+                destPy < yEnd && destRow < vstriping;
+                destPy++, destRow++
+            ) {
+                destIter += width;
+                memcpy(destIter + r1xStart, iter + r1xStart, r1rowLength);
+                if (twoRegions) memcpy(destIter + r2xStart, iter + r2xStart, r2rowLength);
+            }
+        }
+
+        iter += rowStep;
+    }
+    free(columnX);
+}
+
+static void KERNEL_CONCAT(KERNEL_FUNCTION, Plain)(KERNEL_PARAMETERS) {
+    KERNEL_ROWS(KERNEL_ARGUMENTS, false, false, false);
+}
+
+static void KERNEL_CONCAT(KERNEL_FUNCTION, Striped)(KERNEL_PARAMETERS) {
+    KERNEL_ROWS(KERNEL_ARGUMENTS, true, false, false);
+}
+
+static void KERNEL_CONCAT(KERNEL_FUNCTION, StripedFill)(KERNEL_PARAMETERS) {
+    KERNEL_ROWS(KERNEL_ARGUMENTS, true, true, false);
+}
+
+static void KERNEL_CONCAT(KERNEL_FUNCTION, TwoRegion)(KERNEL_PARAMETERS) {
+    KERNEL_ROWS(KERNEL_ARGUMENTS, false, false, true);
+}
+
+/** Two striped regions, no task makes one but the kernel still takes it */
+static void KERNEL_CONCAT(KERNEL_FUNCTION, Any)(KERNEL_PARAMETERS) {
+    KERNEL_ROWS(KERNEL_ARGUMENTS, hstriping >= 2, hstriping >= 2 && hfillIn, true);
+}
+
+void KERNEL_FUNCTION(KERNEL_PARAMETERS) {
+    if (region2 && hstriping >= 2)
+        KERNEL_CONCAT(KERNEL_FUNCTION, Any)(KERNEL_ARGUMENTS);
+    else if (region2)
+        KERNEL_CONCAT(KERNEL_FUNCTION, TwoRegion)(KERNEL_ARGUMENTS);
+    else if (hstriping < 2)
+        KERNEL_CONCAT(KERNEL_FUNCTION, Plain)(KERNEL_ARGUMENTS);
+    else if (!hfillIn)
+        KERNEL_CONCAT(KERNEL_FUNCTION, Striped)(KERNEL_ARGUMENTS);
+    else
+        KERNEL_CONCAT(KERNEL_FUNCTION, StripedFill)(KERNEL_ARGUMENTS);
+}
+
+#ifdef KERNEL_RESUME
+/** Same escape loop as KERNEL_SPAN over a list of points, so resumed pixels end exactly where calculate() would */
+int KERNEL_RESUME(
+    ResumePoint *points, int count, fracInt *target,
+    int fromIters, int maxIters,
+    double paramR, double paramI,
+    double centerX, double centerY,
+    double pixelStep,
+    int width, int height
+) {
+    KERNEL_REAL paramCr = paramR, paramCi = paramI;
+    (void)paramCr; (void)paramCi;
+    int left = -(int)floor((float)width / 2);
+    int top  = -(int)floor((float)height / 2);
+    int stillInside = 0;
+
+    int i = 0;
+#if KERNEL_LANES > 1
+    typedef KERNEL_REAL KernelVector __attribute__((vector_size(sizeof(KERNEL_REAL) * KERNEL_LANES)));
+    typedef KERNEL_LANE_INT KernelMask __attribute__((vector_size(sizeof(KERNEL_REAL) * KERNEL_LANES)));
+#define KERNEL_VALUE KernelVector
+#define KERNEL_ZERO ((KernelVector){ 0 })
+    for (; i + KERNEL_LANES <= count; i += KERNEL_LANES) {
+        KernelVector x, y, cr, ci;
+        uint32_t index[KERNEL_LANES];
+        for (int lane = 0; lane < KERNEL_LANES; lane++) {
+            const ResumePoint *point = &points[i + lane];
+            index[lane] = point->index;
+            x[lane] = (KERNEL_REAL)centerX + (KERNEL_REAL)pixelStep * (left + (int)(point->index % width));
+            y[lane] = (KERNEL_REAL)centerY + (KERNEL_REAL)pixelStep * (top + (int)(point->index / width));
+            cr[lane] = point->cr;
+            ci[lane] = point->ci;
+        }
+        if (fromIters == 0) {
+            KERNEL_START
+        }
+        KernelMask iters = (KernelMask){ 0 } + fromIters;
+        for (int n = fromIters; n < maxIters; n++) {
+            KernelMask inside = (cr < 4) & (cr > -4) & (ci < 4) & (ci > -4);
+            bool anyInside = false;
+            for (int lane = 0; lane < KERNEL_LANES; lane++)
+                anyInside |= inside[lane] != 0;
+            if (!anyInside) break;
+            iters -= inside;
+            KERNEL_ITERATE
+        }
+        // Points before i + lane were all read, so the survivors can move down over them
+        for (int lane = 0; lane < KERNEL_LANES; lane++) {
+            target[index[lane]] = iters[lane];
+            if (iters[lane] == maxIters)
+                points[stillInside++] = (ResumePoint){ index[lane], cr[lane], ci[lane] };
+        }
+    }
+#undef KERNEL_VALUE
+#undef KERNEL_ZERO
+#endif
+#define KERNEL_VALUE KERNEL_REAL
+#define KERNEL_ZERO 0
+    for (; i < count; i++) {
+        ResumePoint point = points[i];
+        KERNEL_REAL x = (KERNEL_REAL)centerX + (KERNEL_REAL)pixelStep * (left + (int)(point.index % width));
+        KERNEL_REAL y = (KERNEL_REAL)centerY + (KERNEL_REAL)pixelStep * (top + (int)(point.index / width));
+        KERNEL_REAL cr = point.cr, ci = point.ci;
+        if (fromIters == 0) {
+            KERNEL_START
+        }
+        int iters = fromIters;
+        while (cr < 4 && cr > -4 && ci < 4 && ci > -4 && iters < maxIters) {
+            iters++;
+            KERNEL_ITERATE
+        }
+        target[point.index] = iters;
+        if (iters == maxIters)
+            points[stillInside++] = (ResumePoint){ point.index, cr, ci };
+    }
+#undef KERNEL_VALUE
+#undef KERNEL_ZERO
+    return stillInside;
+}
+#undef KERNEL_RESUME
+#endif
+
+#undef KERNEL_SPAN
+#undef KERNEL_ROWS
+#undef KERNEL_CONTINUE
+#undef KERNEL_FUNCTION
+#undef KERNEL_REAL
+#undef KERNEL_LANES
+#undef KERNEL_LANE_INT
@@ -2,120 +2,220 @@
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include <float.h>
 
 #include "mandelbrot.h"
 
-void calculate(
-    fracInt *target, int maxIters,
-    double centerX, double centerY,
-    double pixelStep,
-    int width, int height,
-    short hstriping, short hstripeOffset, bool hfillIn,
-    short vstriping, short vstripeOffset, bool vfillIn,
-    int yStart, int yEnd,
-    int r1xStart, int r1xEnd,
-    bool region2, int r2xStart, int r2xEnd
+/**
+ * Required pixelStep in units of epsilon * magnitude * maxIters. Every iteration rounds z by about that much,
+ * which after n iterations shifts the orbit like moving c by up to n times it, so this keeps c within
+ * 1 / PRECISION_MARGIN of a pixel.
+ */
+#define PRECISION_MARGIN 16
+/** Orbits stay inside the escape box, so magnitudes are at least this */
+#define PRECISION_ORBIT_BOUND 4
+/** Validation samples PRECISION_SAMPLES x PRECISION_SAMPLES pixels */
+#define PRECISION_SAMPLES 8
+
+/** fabs would round float and long double kernels through double */
+#define KERNEL_ABS(value) ((value) < 0 ? -(value) : (value))
+
+// Mandelbrot: z = z^2 + c, c = pixel
+#define KERNEL_NAME calculateMandelbrot
+#define KERNEL_START cr = KERNEL_ZERO; ci = KERNEL_ZERO;
+#define KERNEL_ITERATE \
+    KERNEL_VALUE newCr = cr * cr - ci * ci + x; \
+    ci = 2 * cr * ci + y; \
+    cr = newCr;
+#include "tiers.h"
+
+// Julia: z = z^2 + param, z0 = pixel
+#define KERNEL_NAME calculateJulia
+#define KERNEL_START cr = x; ci = y;
+#define KERNEL_ITERATE \
+    KERNEL_VALUE newCr = cr * cr - ci * ci + paramCr; \
+    ci = 2 * cr * ci + paramCi; \
+    cr = newCr;
+#include "tiers.h"
+
+// Burning Ship: z = (|Re z| + i|Im z|)^2 + c, KERNEL_ABS has no vector form
+#define KERNEL_SCALAR
+#define KERNEL_NAME calculateBurningShip
+#define KERNEL_START cr = KERNEL_ZERO; ci = KERNEL_ZERO;
+#define KERNEL_ITERATE \
+    KERNEL_VALUE newCr = cr * cr - ci * ci + x; \
+    ci = 2 * KERNEL_ABS(cr * ci) + y; \
+    cr = newCr;
+#include "tiers.h"
+
+// Tricorn: z = conj(z)^2 + c
+#define KERNEL_NAME calculateTricorn
+#define KERNEL_START cr = KERNEL_ZERO; ci = KERNEL_ZERO;
+#define KERNEL_ITERATE \
+    KERNEL_VALUE newCr = cr * cr - ci * ci + x; \
+    ci = -2 * cr * ci + y; \
+    cr = newCr;
+#include "tiers.h"
+
+// Multibrot: z = z^3 + c
+#define KERNEL_NAME calculateMultibrot3
+#define KERNEL_START cr = KERNEL_ZERO; ci = KERNEL_ZERO;
+#define KERNEL_ITERATE \
+    KERNEL_VALUE cr2 = cr * cr, ci2 = ci * ci; \
+    KERNEL_VALUE newCr = cr * (cr2 - 3 * ci2) + x; \
+    ci = ci * (3 * cr2 - ci2) + y; \
+    cr = newCr;
+#include "tiers.h"
+
+// Multibrot: z = z^4 + c, squared twice
+#define KERNEL_NAME calculateMultibrot4
+#define KERNEL_START cr = KERNEL_ZERO; ci = KERNEL_ZERO;
+#define KERNEL_ITERATE \
+    KERNEL_VALUE sqCr = cr * cr - ci * ci, sqCi = 2 * cr * ci; \
+    KERNEL_VALUE newCr = sqCr * sqCr - sqCi * sqCi + x; \
+    ci = 2 * sqCr * sqCi + y; \
+    cr = newCr;
+#include "tiers.h"
+
+#define KERNELS(name) { [PRECISION_FLOAT] = name##Float, [PRECISION_DOUBLE] = name, [PRECISION_EXTENDED] = name##Extended }
+
+const Formula formulas[FORMULA_COUNT] = {
+    [FORMULA_MANDELBROT]    = { "Mandelbrot", KERNELS(calculateMandelbrot), calculateMandelbrotResume, 0, 0, true, -0.74, -0.22, 0.01 },
+    [FORMULA_JULIA]         = { "Julia", KERNELS(calculateJulia), calculateJuliaResume, -0.8, 0.156, false, 0, 0, 1.6 },
+    [FORMULA_BURNING_SHIP]  = { "Burning Ship", KERNELS(calculateBurningShip), calculateBurningShipResume, 0, 0, false, -0.45, -0.5, 1.2 },
+    [FORMULA_TRICORN]       = { "Tricorn", KERNELS(calculateTricorn), calculateTricornResume, 0, 0, true, -0.3, 0, 1.6 },
+    [FORMULA_MULTIBROT3]    = { "Multibrot 3", KERNELS(calculateMultibrot3), calculateMultibrot3Resume, 0, 0, true, 0, 0, 1.4 },
+    [FORMULA_MULTIBROT4]    = { "Multibrot 4", KERNELS(calculateMultibrot4), calculateMultibrot4Resume, 0, 0, true, -0.15, 0, 1.4 },
+};
+
+const char *precisionNames[PRECISION_COUNT] = { "float", "double", "extended" };
+static const long double precisionEpsilon[PRECISION_COUNT] = { FLT_EPSILON, DBL_EPSILON, LDBL_EPSILON };
+
+/** Compares a grid of pixels between precision and the one after it, every one has to match */
+static bool validatePrecision(
+    const Formula *formula, Precision precision, int maxIters,
+    double centerX, double centerY, double pixelStep, int width, int height
 ) {
-    int left   = -(int)floor((float)width / 2);
-    int right  = (int)ceil((float)width / 2);
-    int top    = -(int)floor((float)height / 2);
-    int bottom = (int)ceil((float)height / 2);
+    for (int sy = 0; sy < PRECISION_SAMPLES; sy++) {
+        for (int sx = 0; sx < PRECISION_SAMPLES; sx++) {
+            // Sample centers of an even grid over the view
+            int ix = (int)((sx + 0.5) * width / PRECISION_SAMPLES) - width / 2;
+            int iy = (int)((sy + 0.5) * height / PRECISION_SAMPLES) - height / 2;
+            double x = centerX + pixelStep * ix, y = centerY + pixelStep * iy;
+            fracInt iters, reference;
+            formula->calculate[precision](&iters, maxIters, formula->paramR, formula->paramI,
+                x, y, pixelStep, 1, 1, 0, 0, false, 0, 0, false, 0, 1, 0, 1, false, 0, 0);
+            formula->calculate[precision + 1](&reference, maxIters, formula->paramR, formula->paramI,
+                x, y, pixelStep, 1, 1, 0, 0, false, 0, 0, false, 0, 1, 0, 1, false, 0, 0);
+            if (iters != reference) return false;
+        }
+    }
+    return true;
+}
 
-    if (!region2) {
-        r2xEnd = r1xEnd;
+Precision choosePrecision(
+    const Formula *formula, int maxIters,
+    double centerX, double centerY, double pixelStep,
+    int width, int height, bool *exhausted
+) {
+    double magnitude = fmax(PRECISION_ORBIT_BOUND,
+        fmax(fabs(centerX), fabs(centerY)) + pixelStep * fmax(width, height) / 2);
+    // Rounding piles up over the whole orbit
+    double margin = (double)PRECISION_MARGIN * maxIters;
+    *exhausted = false;
+    for (Precision precision = PRECISION_FLOAT; precision < PRECISION_EXTENDED; precision++) {
+        if (pixelStep < magnitude * precisionEpsilon[precision] * margin) continue;
+        if (validatePrecision(formula, precision, maxIters, centerX, centerY, pixelStep, width, height))
+            return precision;
     }
-    int region2Jump = r2xStart - r1xEnd;
-    
-    int yInc = 1, xInc = 1;
-    short yStripeOffset = 0, r1xStripeOffset = 0, r2xStripeOffset = 0;
-    // Align starts with striping and offset (move right by as little as possible)
-    if (vstriping >= 2) {
-        yInc = vstriping;
-        yStripeOffset = (10000 * vstriping - (top + yStart) + vstripeOffset) % vstriping;
+    *exhausted = pixelStep < magnitude * precisionEpsilon[PRECISION_EXTENDED] * margin;
+    return PRECISION_EXTENDED;
+}
+
+/** Closed range of doubles, every operation below is exact for the points it encloses up to their rounding */
+typedef struct {
+    double lo; double hi;
+} Interval;
+
+static inline Interval intervalAdd(Interval a, Interval b) {
+    return (Interval){ a.lo + b.lo, a.hi + b.hi };
+}
+
+static inline Interval intervalSub(Interval a, Interval b) {
+    return (Interval){ a.lo - b.hi, a.hi - b.lo };
+}
+
+/** Products of the corners, rounding each of them rounds the extremes of the exact products */
+static inline Interval intervalMul(Interval a, Interval b) {
+    double p1 = a.lo * b.lo, p2 = a.lo * b.hi, p3 = a.hi * b.lo, p4 = a.hi * b.hi;
+    return (Interval){ fmin(fmin(p1, p2), fmin(p3, p4)), fmax(fmax(p1, p2), fmax(p3, p4)) };
+}
+
+/** Same value twice, tighter than intervalMul(a, a) when a straddles 0 */
+static inline Interval intervalSquare(Interval a) {
+    double lo = a.lo * a.lo, hi = a.hi * a.hi;
+    if (a.lo <= 0 && a.hi >= 0) return (Interval){ 0, fmax(lo, hi) };
+    return (Interval){ fmin(lo, hi), fmax(lo, hi) };
+}
+
+static inline Interval intervalScale(double factor, Interval a) {
+    return factor >= 0 ? (Interval){ factor * a.lo, factor * a.hi } : (Interval){ factor * a.hi, factor * a.lo };
+}
+
+static inline Interval intervalAbs(Interval a) {
+    if (a.lo >= 0) return a;
+    if (a.hi <= 0) return (Interval){ -a.hi, -a.lo };
+    return (Interval){ 0, fmax(-a.lo, a.hi) };
+}
+
+/** One iteration of formulas[formula], in the same order of operations as its KERNEL_ITERATE */
+static inline void intervalIterate(int formula, Interval *cr, Interval *ci, Interval x, Interval y) {
+    Interval newCr;
+    switch (formula) {
+    case FORMULA_MULTIBROT3: {
+        Interval cr2 = intervalSquare(*cr), ci2 = intervalSquare(*ci);
+        newCr = intervalAdd(intervalMul(*cr, intervalSub(cr2, intervalScale(3, ci2))), x);
+        *ci = intervalAdd(intervalMul(*ci, intervalSub(intervalScale(3, cr2), ci2)), y);
+        break;
     }
-    if (hstriping >= 2) {
-        xInc = hstriping;
-        r1xStripeOffset = (10000 * hstriping - (left + r1xStart) + hstripeOffset) % hstriping;
-        if (region2) {
-            r2xStripeOffset = (10000 * hstriping - (left + r2xStart) + hstripeOffset) % hstriping;
-            // We are incrementing from r1xStart by hstriping, therefore once the iterator reaches r1xEnd,
-            // it will be at r1xEnd aligned by striping. We can align it ourselves for ease of calculating jump.
-            int r1xStripeEndOffset = (10000 * hstriping - (left + r1xEnd) + hstripeOffset) % hstriping;
-            region2Jump = r2xStart + r2xStripeOffset - (r1xEnd + r1xStripeEndOffset);
-        }
+    case FORMULA_MULTIBROT4: {
+        Interval sqCr = intervalSub(intervalSquare(*cr), intervalSquare(*ci));
+        Interval sqCi = intervalMul(intervalScale(2, *cr), *ci);
+        newCr = intervalAdd(intervalSub(intervalSquare(sqCr), intervalSquare(sqCi)), x);
+        *ci = intervalAdd(intervalMul(intervalScale(2, sqCr), sqCi), y);
+        break;
     }
+    case FORMULA_BURNING_SHIP:
+        newCr = intervalAdd(intervalSub(intervalSquare(*cr), intervalSquare(*ci)), x);
+        *ci = intervalAdd(intervalScale(2, intervalAbs(intervalMul(*cr, *ci))), y);
+        break;
+    default:
+        // Mandelbrot and Julia, Tricorn conjugates
+        newCr = intervalAdd(intervalSub(intervalSquare(*cr), intervalSquare(*ci)), x);
+        *ci = intervalAdd(intervalMul(intervalScale(formula == FORMULA_TRICORN ? -2 : 2, *cr), *ci), y);
+        break;
+    }
+    *cr = newCr;
+}
 
-    fracInt *iter = target + (yStart + yStripeOffset) * width;
-    size_t rowStep = width * yInc;
-    for (
-        int iy = top + yStart + yStripeOffset, py = yStart + yStripeOffset, row = 0;
-        iy < bottom && py < yEnd;
-        iy += yInc, py += yInc, row++
-    ) {
-        double y = centerY + pixelStep * iy;
-
-        for (
-            int ix = left + r1xStart + r1xStripeOffset, px = r1xStart + r1xStripeOffset, col = 0;
-            ix < right && px < r2xEnd;
-            ix += xInc, px += xInc, col++
-        ) {
-            // If region2 is disabled, r1xEnd = r2xEnd
-            if (px >= r1xEnd && px < r2xStart) {
-                ix += region2Jump;
-                px += region2Jump;
-            }
-            double x = centerX + pixelStep * ix;
-            // Real and Imaginary components
-            double cr = 0;
-            double ci = 0;
-            fracInt iters = 0;
-            while (cr < 4 && cr > -4 && ci < 4 && ci > -4 && iters < maxIters) {
-                iters++;
-                double newCr = cr * cr - ci * ci + x;
-                ci = 2 * cr * ci + y;
-                cr = newCr;
-            }
-            *(iter + px) = iters;
-            if (hfillIn) {
-                // Fill left
-                if (col == 0 && r1xStripeOffset > 0) {
-                    for (int filli = 1; filli <= r1xStripeOffset; filli++)
-                        *(iter + px - filli) = iters;
-                } else if (region2 && r2xStripeOffset > 0 && px == r2xStart + r2xStripeOffset) {
-                    for (int filli = 1; filli <= r2xStripeOffset; filli++)
-                        *(iter + px - filli) = iters;
-                }
-                // Fill right
-                int boundary = px < r1xEnd ? r1xEnd : r2xEnd;
-                for (int destPx = px + 1, destCol = 1; destPx < boundary && destCol < hstriping; destPx++, destCol++)
-                    *(iter + destPx) = iters;
-            }
-        }
-
-        // Fill in skipped stripes
-        if (vfillIn) {
-            size_t r1rowLength = (r1xEnd - r1xStart) * sizeof(fracInt);
-            size_t r2rowLength = (r2xEnd - r2xStart) * sizeof(fracInt);
-            // Fill above
-            if (row == 0 && yStripeOffset > 0) {
-                for (int filli = 1; filli <= yStripeOffset; filli++) {
-                    memcpy(iter - filli * width + r1xStart, iter + r1xStart, r1rowLength);
-                    if (region2) memcpy(iter - filli * width + r2xStart, iter + r2xStart, r2rowLength);
-                }
-            }
-            // Fill below
-            fracInt *destIter = iter;
-            for (
-                int destPy = py + 1, destRow = 1;
-                destPy < yEnd && destRow < vstriping;
-                destPy++, destRow++
-            ) {
-                destIter += width;
-                memcpy(destIter + r1xStart, iter + r1xStart, r1rowLength);
-                if (region2) memcpy(destIter + r2xStart, iter + r2xStart, r2rowLength);
-            }
+int certifyTile(const Formula *formula, int maxIters, double xLo, double xHi, double yLo, double yHi) {
+    int index = (int)(formula - formulas);
+    Interval x = { xLo, xHi }, y = { yLo, yHi };
+    Interval cr = { 0, 0 }, ci = { 0, 0 };
+    if (index == FORMULA_JULIA) {
+        // z starts at the pixel and the parameter is added instead
+        cr = x;
+        ci = y;
+        x = (Interval){ formula->paramR, formula->paramR };
+        y = (Interval){ formula->paramI, formula->paramI };
+    }
+    for (int n = 0; n < maxIters; n++) {
+        bool inside = cr.lo > -4 && cr.hi < 4 && ci.lo > -4 && ci.hi < 4;
+        if (!inside) {
+            bool outside = cr.lo >= 4 || cr.hi <= -4 || ci.lo >= 4 || ci.hi <= -4;
+            return outside ? n : -1;
         }
-
-        iter += rowStep;
+        intervalIterate(index, &cr, &ci, x, y);
     }
+    return maxIters;
 }
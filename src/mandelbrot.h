@@ -1,9 +1,14 @@
+#pragma once
+
 #include <stdint.h>
 #include <stdbool.h>
 
 typedef uint16_t fracInt;
 
 /**
+ * Every formula gets its own copy of this function generated from kernel.h
+ * @param paramR Real part of the formula parameter (Julia constant), ignored by other formulas
+ * @param paramI Imaginary part of the formula parameter
  * @param hstriping 0 = disabled, >1 = number of steps
  * @param hstripeOffset 0 = render at center, 1 = render one right of center, ...
  * @param hfillIn Copy rendered stripe into nonrendered
@@ -11,8 +16,9 @@ typedef uint16_t fracInt;
  * @param p1xEnd Right side of the first region to render
  * @param region2 Enable rendering of the second region
  */
-void calculate(
+typedef void CalculateKernel(
     fracInt *target, int maxIters,
+    double paramR, double paramI,
     double centerX, double centerY,
     double pixelStep,
     int width, int height,
@@ -21,4 +27,82 @@ void calculate(
     int yStart, int yEnd,
     int r1xStart, int r1xEnd,
     bool region2, int r2xStart, int r2xEnd
-);
\ No newline at end of file
+);
+typedef CalculateKernel *CalculateFunction;
+
+/** z of a pixel that had not escaped yet, at index y * width + x of its render */
+typedef struct {
+    uint32_t index;
+    double cr; double ci;
+} ResumePoint;
+
+/**
+ * Continues points[0, count) for iterations [fromIters, maxIters), fromIters 0 starts them from z = 0 or the pixel.
+ * Writes their iterations to target and moves the points still inside at maxIters to the front with their new z.
+ * The other parameters are as for CalculateKernel, results equal calculate() with maxIters in double precision.
+ * @return Points still inside
+ */
+typedef int ResumeKernel(
+    ResumePoint *points, int count, fracInt *target,
+    int fromIters, int maxIters,
+    double paramR, double paramI,
+    double centerX, double centerY,
+    double pixelStep,
+    int width, int height
+);
+typedef ResumeKernel *ResumeFunction;
+
+/** Arithmetic a kernel computes in, cheapest first */
+typedef enum {
+    PRECISION_FLOAT,
+    PRECISION_DOUBLE,
+    /** long double, 80 bit on x86 gcc */
+    PRECISION_EXTENDED,
+    PRECISION_COUNT
+} Precision;
+
+extern const char *precisionNames[PRECISION_COUNT];
+
+typedef struct {
+    const char *name;
+    CalculateFunction calculate[PRECISION_COUNT];
+    /** Double precision only, like renderBlocking */
+    ResumeFunction resume;
+    double paramR; double paramI;
+    /** Symmetric across the real axis, rows mirroring each other are calculated once */
+    bool conjugateSymmetric;
+    /** Initial view when switching to the formula */
+    double offsetX; double offsetY; double zoom;
+} Formula;
+
+enum {
+    FORMULA_MANDELBROT,
+    FORMULA_JULIA,
+    FORMULA_BURNING_SHIP,
+    FORMULA_TRICORN,
+    FORMULA_MULTIBROT3,
+    FORMULA_MULTIBROT4,
+    FORMULA_COUNT
+};
+
+extern const Formula formulas[FORMULA_COUNT];
+
+/**
+ * Picks the cheapest precision whose epsilon is safely below pixelStep relative to the magnitudes involved,
+ * confirmed by comparing sample pixels against the next precision.
+ * @param exhausted Set when even the last tier cannot resolve pixelStep
+ */
+Precision choosePrecision(
+    const Formula *formula, int maxIters,
+    double centerX, double centerY, double pixelStep,
+    int width, int height, bool *exhausted
+);
+
+/**
+ * Proves with interval arithmetic that every pixel with coordinates in [xLo, xHi] x [yLo, yHi] escapes after the
+ * same number of iterations, or does not escape within maxIters. The bounds go through the same operations that
+ * calculate() does on a pixel, and rounding to nearest is monotonic, so they hold every pixel's double precision
+ * orbit and a proven result equals calculate() with PRECISION_DOUBLE exactly.
+ * @return The iterations of every such pixel, -1 when the bounds straddle the escape test
+ */
+int certifyTile(const Formula *formula, int maxIters, double xLo, double xHi, double yLo, double yHi);
@@ -0,0 +1,204 @@
+#include <windows.h>
+#include <process.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "iterfile.h"
+#include "bitmap.h"
+
+#define DEFAULT_PALETTES 8
+#define DEFAULT_THREADS 4
+#define MAX_PALETTES 64
+#define MAX_THREADS 64
+/** Rows a thread colors at once, thread t takes every threadCount-th chunk starting with chunk t */
+#define CHUNK_ROWS 64
+/** Pixels of the bitmaps start here instead of right after the headers, so that they are aligned */
+#define PIXELS_OFFSET 64
+/** Every possible fracInt has an entry, values above maxIters are colored like the interior */
+#define COLOR_ENTRIES (UINT16_MAX + 1)
+
+static const uint8_t *view;
+static const IterFileHeader *header;
+static const uint64_t *rowOffsets;
+static int paletteCount, threadCount;
+static uint32_t *colors[MAX_PALETTES];
+static uint32_t *pixels[MAX_PALETTES];
+static int invalidRows[MAX_THREADS];
+
+/**
+ * Palette p of paletteCount: cosine gradients cycling every 32, 64 or 128 iterations,
+ * their phase spread over the palettes, with a black interior.
+ */
+static void makePalette(uint32_t *entries, int maxIters, int p) {
+    double period = 32 << (p % 3);
+    double phase = (double)p / paletteCount;
+    for (int i = 0; i < COLOR_ENTRIES; i++) {
+        if (i >= maxIters) {
+            entries[i] = 0;
+            continue;
+        }
+        double t = i / period + phase;
+        uint32_t color = 0;
+        for (int channel = 0; channel < 3; channel++)
+            color = color << 8 | (uint8_t)(127.5 * (1 + cos(2 * M_PI * (t + channel / 3.0))));
+        entries[i] = color;
+    }
+}
+
+/** Colors the rows of one thread's chunks with every palette, decoding each row once per palette from the mapping */
+unsigned __stdcall RecolorThreadFunction( void* pArguments ) {
+    int thread = (int)(uintptr_t)pArguments;
+    int width = header->width;
+    for (int chunk = thread; (int64_t)chunk * CHUNK_ROWS < header->height; chunk += threadCount) {
+        int rowEnd = min((int)header->height, (chunk + 1) * CHUNK_ROWS);
+        for (int y = chunk * CHUNK_ROWS; y < rowEnd; y++) {
+            const uint8_t *start = view + rowOffsets[y], *end = view + rowOffsets[y + 1];
+            for (int p = 0; p < paletteCount; p++) {
+                const uint32_t *entries = colors[p];
+                uint32_t *row = pixels[p] + (size_t)y * width;
+                if (header->compression == ITER_RAW) {
+                    const fracInt *values = (const fracInt*)start;
+                    for (int x = 0; x < width; x++) row[x] = entries[values[x]];
+                    continue;
+                }
+                // Uniform runs only look up their color once
+                int x = 0;
+                for (const IterRun *run = (const IterRun*)start; run < (const IterRun*)end; run++) {
+                    if (run->count > width - x) break;
+                    uint32_t color = entries[run->value];
+                    for (int i = 0; i < run->count; i++) row[x + i] = color;
+                    x += run->count;
+                }
+                if (x != width) {
+                    memset(row, 0, width * sizeof(uint32_t));
+                    if (p == 0) invalidRows[thread]++;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Batch recoloring of a raw iteration file written by still: the file is memory mapped and colored
+ * with many palettes at once on several threads, each palette into its own memory mapped bitmap.
+ */
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: recolor <file.iter> <output prefix> [palettes (1-%d)] [threads]\n", MAX_PALETTES);
+        return 1;
+    }
+    const char *path = argv[1], *prefix = argv[2];
+    paletteCount = argc > 3 ? atoi(argv[3]) : DEFAULT_PALETTES;
+    threadCount = argc > 4 ? atoi(argv[4]) : DEFAULT_THREADS;
+    if (paletteCount < 1 || paletteCount > MAX_PALETTES || threadCount < 1 || threadCount > MAX_THREADS) {
+        fprintf(stderr, "Invalid palette or thread count\n");
+        return 1;
+    }
+
+    LARGE_INTEGER perfFrequency, perfStart, perfMapped, perfEnd;
+    QueryPerformanceFrequency(&perfFrequency);
+    QueryPerformanceCounter(&perfStart);
+
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER size = { 0 };
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || size.QuadPart < (int64_t)sizeof(IterFileHeader)) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return 1;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : 0;
+    if (!view) {
+        fprintf(stderr, "Could not map %s\n", path);
+        return 1;
+    }
+    header = (const IterFileHeader*)view;
+    rowOffsets = (const uint64_t*)(view + sizeof(IterFileHeader));
+    // Validate the layout once, the threads only check the runs of every row
+    bool valid = memcmp(header->magic, ITER_MAGIC, 4) == 0 && header->version == ITER_VERSION
+        && header->elementBytes == sizeof(fracInt) && header->compression <= ITER_RLE
+        && header->width > 0 && header->height > 0 && header->width <= INT32_MAX / 4
+        && sizeof(IterFileHeader) + ((uint64_t)header->height + 1) * sizeof(uint64_t) <= (uint64_t)size.QuadPart;
+    for (uint32_t y = 0; valid && y < header->height; y++) {
+        uint64_t bytes = rowOffsets[y + 1] - rowOffsets[y];
+        valid = rowOffsets[y] <= rowOffsets[y + 1] && rowOffsets[y + 1] <= (uint64_t)size.QuadPart
+            && rowOffsets[y] % sizeof(fracInt) == 0
+            && (header->compression == ITER_RAW ? bytes == header->width * sizeof(fracInt) : bytes % sizeof(IterRun) == 0);
+    }
+    if (!valid) {
+        fprintf(stderr, "Invalid iteration file %s\n", path);
+        return 1;
+    }
+    int width = header->width, height = header->height;
+    printf("%s: %dx%d, %s, %.1f MB (%.1f%% of raw), center (%g, %g) step %g, %d iterations\n",
+        path, width, height, header->compression == ITER_RLE ? "run-length" : "raw", size.QuadPart / 1e6,
+        100.0 * size.QuadPart / ((double)width * height * sizeof(fracInt)),
+        header->centerX, header->centerY, header->pixelStep, header->maxIters);
+
+    // One memory mapped bitmap per palette
+    uint64_t bitmapBytes = PIXELS_OFFSET + (uint64_t)width * height * sizeof(uint32_t);
+    if (bitmapBytes > UINT32_MAX) {
+        fprintf(stderr, "Too large for a bitmap\n");
+        return 1;
+    }
+    HANDLE outputFiles[MAX_PALETTES], outputMappings[MAX_PALETTES];
+    uint8_t *outputViews[MAX_PALETTES];
+    for (int p = 0; p < paletteCount; p++) {
+        char outputPath[MAX_PATH];
+        snprintf(outputPath, sizeof(outputPath), "%s_%d.bmp", prefix, p);
+        outputFiles[p] = CreateFileA(outputPath, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        outputMappings[p] = outputFiles[p] == INVALID_HANDLE_VALUE ? 0
+            : CreateFileMappingA(outputFiles[p], NULL, PAGE_READWRITE, 0, (DWORD)bitmapBytes, NULL);
+        outputViews[p] = outputMappings[p] ? MapViewOfFile(outputMappings[p], FILE_MAP_WRITE, 0, 0, 0) : 0;
+        if (!outputViews[p]) {
+            fprintf(stderr, "Could not create %s\n", outputPath);
+            return 1;
+        }
+        BITMAPFILEHEADER fileHeader;
+        BITMAPINFOHEADER infoHeader;
+        bitmapHeaders(&fileHeader, &infoHeader, width, height);
+        fileHeader.bfOffBits = PIXELS_OFFSET;
+        fileHeader.bfSize = (DWORD)bitmapBytes;
+        memcpy(outputViews[p], &fileHeader, sizeof(fileHeader));
+        memcpy(outputViews[p] + sizeof(fileHeader), &infoHeader, sizeof(infoHeader));
+        pixels[p] = (uint32_t*)(outputViews[p] + PIXELS_OFFSET);
+        colors[p] = malloc(COLOR_ENTRIES * sizeof(uint32_t));
+        makePalette(colors[p], header->maxIters, p);
+    }
+    QueryPerformanceCounter(&perfMapped);
+
+    HANDLE threads[MAX_THREADS];
+    for (int t = 0; t < threadCount; t++)
+        threads[t] = (HANDLE)_beginthreadex(NULL, 0, RecolorThreadFunction, (void*)(uintptr_t)t, 0, NULL);
+    int invalid = 0;
+    for (int t = 0; t < threadCount; t++) {
+        if (threads[t]) {
+            WaitForSingleObject(threads[t], INFINITE);
+            CloseHandle(threads[t]);
+        } else {
+            RecolorThreadFunction((void*)(uintptr_t)t);
+        }
+        invalid += invalidRows[t];
+    }
+    QueryPerformanceCounter(&perfEnd);
+
+    for (int p = 0; p < paletteCount; p++) {
+        UnmapViewOfFile(outputViews[p]);
+        CloseHandle(outputMappings[p]);
+        CloseHandle(outputFiles[p]);
+        free(colors[p]);
+    }
+    UnmapViewOfFile(view);
+    CloseHandle(mapping);
+    CloseHandle(file);
+
+    double setupMs = (double)(perfMapped.QuadPart - perfStart.QuadPart) * 1000 / perfFrequency.QuadPart;
+    double colorMs = (double)(perfEnd.QuadPart - perfMapped.QuadPart) * 1000 / perfFrequency.QuadPart;
+    double megapixels = (double)width * height * paletteCount / 1e6;
+    printf("%d palettes on %d threads: %.1f megapixels colored in %.0fms (%.0f megapixels/s), setup %.0fms\n",
+        paletteCount, threadCount, megapixels, colorMs, megapixels / (colorMs / 1000), setupMs);
+    if (invalid) fprintf(stderr, "%d rows did not decode and are black\n", invalid);
+    return invalid ? 1 : 0;
+}
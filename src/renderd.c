@@ -0,0 +1,289 @@
+#include <windows.h>
+#include <process.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "renderer.h"
+#include "renderservice.h"
+
+/** Jobs rendered at once, each one spreads its rows over the whole worker pool */
+#define DISPATCH_THREADS 8
+/** Jobs queued or rendering, requests beyond that are answered with RENDER_BUSY */
+#define MAX_JOBS 256
+/** Pixels two views may be off the same grid by and still share a render */
+#define GRID_TOLERANCE 1e-3
+#define PIPE_BUFFER (64 * 1024)
+#define REPORT_MS 5000
+
+typedef enum {
+    JOB_QUEUED,
+    JOB_RUNNING,
+    JOB_DONE,
+} JobState;
+
+/** One render in flight, every request it covers waits on it */
+typedef struct {
+    /** View rendered, a queued job grows to cover overlapping requests */
+    RenderRequest view;
+    RenderPriority priority;
+    JobState state;
+    /** Requests waiting for it, the last one to read the result frees the job */
+    int waiters;
+    HANDLE doneSemaphore;
+    fracInt *iters;
+    LARGE_INTEGER startTime;
+    double renderMs;
+} Job;
+
+/** Guards everything below */
+HANDLE jobSemaphore = 0;
+/** Released once per queued job */
+HANDLE pendingSemaphore = 0;
+/** Queued and rendering jobs in arrival order */
+Job *jobs[MAX_JOBS] = { 0 };
+int jobCount = 0;
+
+// Counts since the last report
+int requestCounts[RENDER_SOURCE_COUNT] = { 0 };
+int promotedCount = 0;
+LARGE_INTEGER reportTime;
+
+/**
+ * Pixel offset of b's top left pixel from a's when both lie on the same pixel grid.
+ * Identical views give 0 offsets and the same size, their pixels are computed identically.
+ */
+bool gridOffset(const RenderRequest *a, const RenderRequest *b, int *dx, int *dy) {
+    if (a->formula != b->formula || a->pixelStep != b->pixelStep) return false;
+    double x = (b->centerX - a->centerX) / a->pixelStep - ((int)b->width / 2 - (int)a->width / 2);
+    double y = (b->centerY - a->centerY) / a->pixelStep - ((int)b->height / 2 - (int)a->height / 2);
+    if (fabs(x) > RENDER_MAX_SIZE || fabs(y) > RENDER_MAX_SIZE) return false;
+    *dx = (int)round(x);
+    *dy = (int)round(y);
+    return fabs(x - *dx) <= GRID_TOLERANCE && fabs(y - *dy) <= GRID_TOLERANCE;
+}
+
+/**
+ * Only use with jobSemaphore, finds a job in flight that covers request or can grow to cover it.
+ * Only queued jobs grow, and only while the union costs no more than rendering both.
+ */
+Job *findCoveringJob(const RenderRequest *request, RenderSource *source) {
+    for (int i = 0; i < jobCount; i++) {
+        Job *job = jobs[i];
+        int dx, dy;
+        if (!gridOffset(&job->view, request, &dx, &dy)) continue;
+        // Its tasks already wait behind every interactive one
+        if (job->state == JOB_RUNNING && job->priority < request->priority) continue;
+        int width = job->view.width, height = job->view.height;
+        if (dx >= 0 && dy >= 0 && dx + (int)request->width <= width && dy + (int)request->height <= height) {
+            *source = dx == 0 && dy == 0 && request->width == width && request->height == height ? RENDER_SHARED : RENDER_CROPPED;
+            return job;
+        }
+        if (job->state != JOB_QUEUED) continue;
+        int left = min(0, dx), top = min(0, dy);
+        int right = max(width, dx + (int)request->width), bottom = max(height, dy + (int)request->height);
+        bool overlapping = dx < width && dy < height && dx + (int)request->width > 0 && dy + (int)request->height > 0;
+        if (!overlapping || right - left > RENDER_MAX_SIZE || bottom - top > RENDER_MAX_SIZE
+            || (int64_t)(right - left) * (bottom - top) > (int64_t)width * height + (int64_t)request->width * request->height)
+            continue;
+        // Move the center by whole pixels so the grid stays the same
+        job->view.centerX += job->view.pixelStep * (left + (right - left) / 2 - width / 2);
+        job->view.centerY += job->view.pixelStep * (top + (bottom - top) / 2 - height / 2);
+        job->view.width = right - left;
+        job->view.height = bottom - top;
+        *source = RENDER_CROPPED;
+        return job;
+    }
+    return 0;
+}
+
+/** Returns the job request waits on, 0 when too many are in flight */
+Job *submit(const RenderRequest *request, RenderSource *source) {
+    WaitForSingleObject(jobSemaphore, INFINITE);
+    Job *job = findCoveringJob(request, source);
+    if (job) {
+        job->waiters++;
+        // A queued batch job that an interactive request waits on is interactive now
+        if (job->state == JOB_QUEUED && request->priority > job->priority) {
+            job->priority = request->priority;
+            promotedCount++;
+        }
+    } else if (jobCount < MAX_JOBS) {
+        job = calloc(1, sizeof(Job));
+        job->view = *request;
+        job->priority = request->priority;
+        job->waiters = 1;
+        job->doneSemaphore = CreateSemaphore(NULL, 0, MAX_JOBS * 64, NULL);
+        jobs[jobCount++] = job;
+        *source = RENDER_RENDERED;
+        ReleaseSemaphore(pendingSemaphore, 1, NULL);
+    }
+    if (job) requestCounts[*source]++;
+    ReleaseSemaphore(jobSemaphore, 1, NULL);
+    return job;
+}
+
+/** Takes queued jobs, highest priority and oldest first, and renders them on the worker pool */
+unsigned __stdcall DispatchThreadFunction( void* pArguments ) {
+    LARGE_INTEGER perfFrequency, perfEnd;
+    QueryPerformanceFrequency(&perfFrequency);
+    while (true) {
+        if (WaitForSingleObject(pendingSemaphore, INFINITE) != 0) continue;
+        WaitForSingleObject(jobSemaphore, INFINITE);
+        Job *job = 0;
+        for (int i = 0; i < jobCount; i++) {
+            if (jobs[i]->state == JOB_QUEUED && (!job || jobs[i]->priority > job->priority)) job = jobs[i];
+        }
+        if (job) {
+            job->state = JOB_RUNNING;
+            QueryPerformanceCounter(&job->startTime);
+        }
+        ReleaseSemaphore(jobSemaphore, 1, NULL);
+        if (!job) continue;
+
+        // The view no longer changes once running
+        job->iters = malloc((size_t)job->view.width * job->view.height * sizeof(fracInt));
+        renderPrioritized(job->priority, &formulas[job->view.formula], job->iters,
+            job->view.centerX, job->view.centerY, job->view.pixelStep, job->view.width, job->view.height);
+        QueryPerformanceCounter(&perfEnd);
+        job->renderMs = (double)(perfEnd.QuadPart - job->startTime.QuadPart) * 1000 / perfFrequency.QuadPart;
+
+        WaitForSingleObject(jobSemaphore, INFINITE);
+        for (int i = 0; i < jobCount; i++) {
+            if (jobs[i] != job) continue;
+            memmove(jobs + i, jobs + i + 1, (jobCount - i - 1) * sizeof(Job*));
+            jobCount--;
+            break;
+        }
+        job->state = JOB_DONE;
+        ReleaseSemaphore(job->doneSemaphore, job->waiters, NULL);
+
+        if ((perfEnd.QuadPart - reportTime.QuadPart) * 1000 / perfFrequency.QuadPart >= REPORT_MS) {
+            double seconds = (double)(perfEnd.QuadPart - reportTime.QuadPart) / perfFrequency.QuadPart;
+            int requests = requestCounts[RENDER_RENDERED] + requestCounts[RENDER_SHARED] + requestCounts[RENDER_CROPPED];
+            printf("%.1f requests/s: %d rendered, %d shared, %d cropped, %d promoted, %d jobs in flight\n",
+                requests / seconds, requestCounts[RENDER_RENDERED], requestCounts[RENDER_SHARED],
+                requestCounts[RENDER_CROPPED], promotedCount, jobCount);
+            fflush(stdout);
+            memset(requestCounts, 0, sizeof(requestCounts));
+            promotedCount = 0;
+            reportTime = perfEnd;
+        }
+        ReleaseSemaphore(jobSemaphore, 1, NULL);
+    }
+    return 0;
+}
+
+/** Serves the requests of one client until it disconnects */
+unsigned __stdcall ConnectionThreadFunction( void* pArguments ) {
+    HANDLE pipe = pArguments;
+    LARGE_INTEGER perfFrequency, perfArrival;
+    QueryPerformanceFrequency(&perfFrequency);
+    fracInt *crop = 0;
+    size_t cropCapacity = 0;
+    RenderRequest request;
+    while (pipeRead(pipe, &request, sizeof(request))) {
+        QueryPerformanceCounter(&perfArrival);
+        RenderResponse response = { RENDER_INVALID };
+        if (request.magic != RENDER_MAGIC || request.formula >= FORMULA_COUNT
+            || request.priority > RENDER_PRIORITY_INTERACTIVE || !(request.pixelStep > 0)
+            || request.width < 1 || request.height < 1 || request.width > RENDER_MAX_SIZE || request.height > RENDER_MAX_SIZE) {
+            if (!pipeWrite(pipe, &response, sizeof(response))) break;
+            continue;
+        }
+        RenderSource source;
+        Job *job = submit(&request, &source);
+        if (!job) {
+            response.status = RENDER_BUSY;
+            if (!pipeWrite(pipe, &response, sizeof(response))) break;
+            continue;
+        }
+        WaitForSingleObject(job->doneSemaphore, INFINITE);
+
+        response = (RenderResponse){ RENDER_OK, source, request.width, request.height,
+            (double)(job->startTime.QuadPart - perfArrival.QuadPart) * 1000 / perfFrequency.QuadPart, job->renderMs };
+        // Joined a job that started before the request arrived
+        if (response.waitMs < 0) response.waitMs = 0;
+        const fracInt *pixels = job->iters;
+        int dx = 0, dy = 0;
+        gridOffset(&job->view, &request, &dx, &dy);
+        // The job may have grown after the request joined it
+        if (dx != 0 || dy != 0 || job->view.width != request.width || job->view.height != request.height) {
+            if (source == RENDER_SHARED) response.source = RENDER_CROPPED;
+            size_t count = (size_t)request.width * request.height;
+            if (count > cropCapacity) {
+                cropCapacity = count;
+                crop = realloc(crop, cropCapacity * sizeof(fracInt));
+            }
+            for (int y = 0; y < request.height; y++)
+                memcpy(crop + (size_t)y * request.width, job->iters + (size_t)(dy + y) * job->view.width + dx,
+                    request.width * sizeof(fracInt));
+            pixels = crop;
+        }
+        bool written = pipeWrite(pipe, &response, sizeof(response))
+            && pipeWrite(pipe, pixels, (size_t)request.width * request.height * sizeof(fracInt));
+
+        WaitForSingleObject(jobSemaphore, INFINITE);
+        job->waiters--;
+        if (job->waiters == 0) {
+            CloseHandle(job->doneSemaphore);
+            free(job->iters);
+            free(job);
+        }
+        ReleaseSemaphore(jobSemaphore, 1, NULL);
+        if (!written) break;
+    }
+    free(crop);
+    FlushFileBuffers(pipe);
+    DisconnectNamedPipe(pipe);
+    CloseHandle(pipe);
+    return 0;
+}
+
+/**
+ * Long running render service: takes render requests over a named pipe,
+ * coalesces requests for the same pixels and renders interactive requests before batch ones.
+ */
+int main(int argc, char **argv) {
+    unsigned int threadCount = argc > 1 ? atoi(argv[1]) : 0;
+    jobSemaphore = CreateSemaphore(NULL, 1, 1, NULL);
+    pendingSemaphore = CreateSemaphore(NULL, 0, MAX_JOBS, NULL);
+    if (!jobSemaphore || !pendingSemaphore || rendererInitialize(threadCount)) {
+        fprintf(stderr, "Error initializing renderer\n");
+        rendererExit();
+        return 1;
+    }
+    QueryPerformanceCounter(&reportTime);
+    for (int i = 0; i < DISPATCH_THREADS; i++) {
+        HANDLE thread = (HANDLE)_beginthreadex(NULL, 0, DispatchThreadFunction, NULL, 0, NULL);
+        if (!thread) {
+            fprintf(stderr, "Error starting dispatch threads\n");
+            return 1;
+        }
+        CloseHandle(thread);
+    }
+    printf("Serving %s with %d worker threads\n", RENDER_PIPE_NAME, rendererThreadCount());
+    fflush(stdout);
+
+    while (true) {
+        HANDLE pipe = CreateNamedPipeA(RENDER_PIPE_NAME, PIPE_ACCESS_DUPLEX, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
+            PIPE_UNLIMITED_INSTANCES, PIPE_BUFFER, PIPE_BUFFER, 0, NULL);
+        if (pipe == INVALID_HANDLE_VALUE) {
+            fprintf(stderr, "Could not create pipe %s\n", RENDER_PIPE_NAME);
+            return 1;
+        }
+        if (!ConnectNamedPipe(pipe, NULL) && GetLastError() != ERROR_PIPE_CONNECTED) {
+            CloseHandle(pipe);
+            continue;
+        }
+        HANDLE thread = (HANDLE)_beginthreadex(NULL, 0, ConnectionThreadFunction, pipe, 0, NULL);
+        if (thread) {
+            CloseHandle(thread);
+        } else {
+            DisconnectNamedPipe(pipe);
+            CloseHandle(pipe);
+        }
+    }
+    return 0;
+}
@@ -10,6 +10,8 @@
 #include "util.h"
 #include "renderer.h"
 #include "mandelbrot.h"
+#include "tiles.h"
+#include "framering.h"
 
 // 1 = show initialization and exit details
 // 2 = show calculate operation starts and ends + swap
@@ -20,19 +22,36 @@
 #define DEBUG_WORKER 0
 #define DEBUG_REDRAW 0
 #define DEBUG_TIME 1
+// 1 = show deadline hit rate and quality of interactive steps
+#define DEBUG_QUALITY 1
+// 1 = show frames that did not fit the frame ring
+#define DEBUG_EXPORT 1
+// 1 = show how many uncovered pixels were prefetched and how much idle worker time prefetching used
+// 2 = also for every move
+#define DEBUG_PREFETCH 1
+// 1 = show the tuning profile loaded
+#define DEBUG_TUNING 1
 
 #define MAX_THREADS 16
-#define MAX_QUEUE 100
-
-// User params
-volatile int desiredWidth = 622;
-volatile int desiredHeight = 433;
-// volatile double desiredZoom = 0.2;
-// volatile double desiredOffsetX = -0.6;
-// volatile double desiredOffsetY = 0;
-volatile double desiredZoom = 0.01;
-volatile double desiredOffsetX = -0.74;
-volatile double desiredOffsetY = -0.22;
+/** Tasks a queue has room for, tuning.maxTasks splits renders into at most this many */
+#define MAX_QUEUE 256
+/** Task queues the worker pool takes from at once, one per busy renderer or blocking render */
+#define MAX_ACTIVE_QUEUES 64
+/** Largest samples x samples grid of a supersampled pixel */
+#define AA_MAX_SAMPLES 8
+/** Orbit density samples c from the square of this radius around 0, every orbit from outside escapes at once */
+#define DENSITY_SAMPLE_RADIUS 2
+/** Sample tasks handed out per worker thread in every density round */
+#define DENSITY_TASKS_PER_THREAD 8
+/** Buffers get this much more room than asked for, so that resizing a little never reallocates */
+#define BUFFER_HEADROOM 1.25
+/** Certified renders try tiles this large first, failed ones are split into quarters down to CERTIFY_MIN_TILE */
+#define CERTIFY_TILE 32
+#define CERTIFY_MIN_TILE 8
+/** Pixels of the first resumable render are iterated in chunks this large, as points on the worker's stack */
+#define RESUME_CHUNK 1024
+/** Resumable renders get a task per this many pixels or points, at least one per worker thread */
+#define RESUME_TASK_POINTS 16384
 
 typedef struct {
     int width;
@@ -40,16 +59,64 @@ typedef struct {
     double pixelStep;
     double offsetX;
     double offsetY;
+    const Formula *formula;
 } DesiredParams;
 
-#define STRIPING 3
-#define striping_row_started(arr, y) ((arr)[y][0] || (arr)[y][1] || (arr)[y][2])
-#define striping_row_done(arr, y) ((arr)[y][0] && (arr)[y][1] && (arr)[y][2])
-#define striping_done(arr) (striping_row_done(arr, 0) && striping_row_done(arr, 1) && striping_row_done(arr, 2))
+/**
+ * Progressive passes start with every PROGRESSIVE_STEP-th pixel in both directions,
+ * then each level halves the grid horizontally and then vertically, down to every pixel.
+ */
+#define PROGRESSIVE_LEVELS 4
+#define PROGRESSIVE_STEP (1 << PROGRESSIVE_LEVELS)
+#define PROGRESSIVE_PASSES (2 * PROGRESSIVE_LEVELS + 1)
+/** Without input for this long the view is refined at full quality */
+#define IDLE_MS 250
+/** Lowest iteration limit a first pass is capped to in order to meet a deadline */
+#define MIN_ITERS_CAP 64
+/** Every this many pixels of the last frame sample its iterations */
+#define ITERS_SAMPLE_STRIDE 61
+#define progressive_done(buffer) ((buffer).passesDone >= PROGRESSIVE_PASSES)
+/** Idle workers render a border this wide around the complete view, wider on the sides recent pans uncovered */
+#define PREFETCH_MARGIN 48
+#define PREFETCH_MARGIN_AHEAD 192
+/** The border is rendered in rings from the view outward, every side of a ring split into this many tasks */
+#define PREFETCH_RINGS 4
+#define PREFETCH_SIDE_TASKS 6
+/** Border pixels not rendered yet, above any iteration count */
+#define PREFETCH_EMPTY 0xFFFF
+
+/** What the user did last, each has its own deadline per calculation step */
+typedef enum {
+    INTERACTION_NONE,
+    INTERACTION_PAN,
+    INTERACTION_ZOOM,
+    INTERACTION_RESIZE,
+    INTERACTION_COUNT
+} Interaction;
+
+static const char *interactionNames[INTERACTION_COUNT] = { "idle", "pan", "zoom", "resize" };
+/** Time a step may take in ms, steps when idle only split the refinement into tuning.progressiveBudgetMs instead */
+static const int interactionDeadlines[INTERACTION_COUNT] = {
+    [INTERACTION_PAN] = 16,
+    [INTERACTION_ZOOM] = 100,
+    [INTERACTION_RESIZE] = 16,
+};
+
+/** Cost model and statistics of the quality controller */
+typedef struct {
+    /** Moving average of wall time per pixel without an iteration cap */
+    double pixelNanos;
+    /** Interactive steps and the ones done within their deadline */
+    int steps; int hits;
+    /** Sums over interactive steps of the calculated share of the shown frame and of the iteration limit used */
+    double pixelQuality; double itersQuality;
+} QualityControl;
 
 typedef struct {
     int tag;
     fracInt *array;
+    /** How many values array has room for */
+    int capacity;
     /** Currently being calculated on */
     int wip;
     /** When calculate thread finishes output, it may have been panned since then,
@@ -59,35 +126,71 @@ typedef struct {
     DesiredParams params;
     /** How many pixels are missing in that direction */
     int missingL; int missingR; int missingT; int missingB;
-    /** Current striping status - also modified when panning */
-    bool stripeProgress[STRIPING][STRIPING];
-    /** How many microseconds the first row took to determine how striped the other stripes should be */
-    int rowMicros;
+    /** Progressive passes calculated, pixels between grid pixels hold copies of the grid pixel left of and above them */
+    int passesDone;
+    /** Centered pixel coordinates of grid pixels modulo PROGRESSIVE_STEP - also modified when panning */
+    int phaseX; int phaseY;
+    /** Iteration limit of the first pass, below maxIters when it was capped to meet a deadline */
+    int firstPassIters;
+    /** Arithmetic chosen for the scale, passes and pans of it use the same */
+    Precision precision;
+    /** Rows [mirrorStart, mirrorEnd) were copied from their mirror across the real axis,
+        so their content follows the mirror row's passes instead of their own */
+    int mirrorStart; int mirrorEnd;
 } BufferArray;
 
-volatile BufferArray mainBuffer = { 0 };
-volatile BufferArray swapBuffer = { 0 };
-
-// Threading
-HANDLE statusSemaphore = 0;
-HANDLE bufferSemaphore = 0;
+// Worker pool shared by all renderers
 HANDLE taskSemaphore = 0;
 
 volatile bool threadsRunning = false;
 
-HANDLE panThreadPointer = 0;
 unsigned __stdcall PanThreadFunction( void* pArguments );
-
-HANDLE calculateThreadPointer = 0;
 unsigned __stdcall CalculateThreadFunction( void* pArguments );
+void exportFrame(Renderer *renderer);
 
 unsigned int workerThreadCount = 0;
+const RendererTuning defaultTuning = { .threads = 3, .maxTasks = 100, .panTaskPixels = 10000, .progressiveBudgetMs = 80 };
+RendererTuning tuning = defaultTuning;
+/** Performance counter ticks all workers spent on tasks */
+volatile int64_t workerBusyTicks = 0;
 HANDLE workerThreadPointers[MAX_THREADS] = { 0 };
 unsigned __stdcall WorkerThreadFunction( void* pArguments );
 
+typedef enum {
+    TASK_CALCULATE,
+    TASK_SUPERSAMPLE,
+    TASK_UPSAMPLE,
+    TASK_DENSITY,
+    TASK_DENSITY_MERGE,
+    TASK_RESUME,
+    TASK_CERTIFY,
+} TaskKind;
+
+/** Points a resume task left inside, the first render collects them here since their number is not known before */
+typedef struct {
+    ResumePoint *points;
+    int count;
+    int capacity;
+} ResumeList;
+
+/** Written by each worker to its own entry, read once the certified render is done */
+typedef struct {
+    int certified;
+    int proven;
+    int tried;
+} CertifyCounts;
+
+/** Written by each worker to its own entry, read once the density round is done */
+typedef struct {
+    uint64_t skipped;
+    uint64_t recorded;
+} DensityCounts;
+
 typedef struct {
-    bool taken;
+    /** Formula kernel, chosen once per task so the pixel loop never checks the formula */
+    CalculateFunction calculate;
     fracInt *target; int maxIters;
+    double paramR; double paramI;
     double centerX; double centerY;
     double pixelStep;
     int width; int height;
@@ -96,30 +199,199 @@ typedef struct {
     int yStart; int yEnd;
     int r1xStart; int r1xEnd;
     bool region2; int r2xStart; int r2xEnd;
+    /** TASK_SUPERSAMPLE: colors of pixelList[listStart..listEnd) are replaced by samples x samples averages */
+    TaskKind kind;
+    uint32_t *colors;
+    const int *pixelList; int listStart; int listEnd;
+    short samples;
+    /**
+     * TASK_UPSAMPLE: rows [validTop, validBottom) hold the grid,
+     * rows [skipStart, skipEnd) are copied from their mirror row mirrorSum - row afterwards
+     */
+    int validTop; int validBottom;
+    int skipStart; int skipEnd; int mirrorSum;
+    /** TASK_DENSITY: samples [sampleStart, sampleEnd) add their hits to histograms[worker] and counts to counts[worker],
+        TASK_DENSITY_MERGE: rows [yStart, yEnd) of every histogram are added to density */
+    DensityRender *density;
+    uint32_t **histograms;
+    DensityCounts *counts;
+    uint64_t sampleStart; uint64_t sampleEnd;
+    /** TASK_RESUME: pixels [listStart, listEnd) of the first render or points [listStart, listEnd) of later ones
+        are iterated from fromIters to maxIters, the ones still inside end up in resumeList */
+    ResumableRender *resumable;
+    ResumeList *resumeList;
+    int fromIters;
+    /** TASK_CERTIFY: tiles of rows [yStart, yEnd) of formula are proven or calculated, counted in certifyCounts[worker] */
+    const Formula *formula;
+    CertifyCounts *certifyCounts;
 } WorkerTask;
 
-volatile WorkerTask taskQueue[MAX_QUEUE] = { 0 };
-volatile int tasksTotal = 0;
-volatile int tasksLeft = 0;
+/** Tasks of one render pass, filled by its owner and then run by the pool */
+typedef struct {
+    WorkerTask tasks[MAX_QUEUE];
+    /** Workers only take tasks from the queues of the highest priority waiting */
+    RenderPriority priority;
+    /** Queued tasks, the next one to hand out and the ones not finished yet */
+    volatile int total;
+    volatile int next;
+    volatile int left;
+    /** Set to skip the tasks not handed out yet, they still count as done */
+    volatile bool cancelled;
+    /** Performance counter ticks workers spent on its tasks */
+    volatile int64_t busyTicks;
+} TaskQueue;
+
+/** Queues with tasks to hand out, workers go round those of the highest priority so that every renderer gets its share */
+TaskQueue *volatile activeQueues[MAX_ACTIVE_QUEUES] = { 0 };
+volatile int activeQueueCount = 0;
+volatile int nextActiveQueue = 0;
+
+/**
+ * Border around the complete view rendered by otherwise idle workers, moves copy the strips they uncover from it.
+ * Only touched by the calculate thread, the workers write the pixels of its tasks.
+ */
+typedef struct {
+    /** view plus the margins, pixels are PREFETCH_EMPTY until rendered */
+    fracInt *array;
+    int width; int height;
+    /** View it was set up around and the arithmetic of that view */
+    DesiredParams view;
+    Precision precision;
+    int marginL; int marginR; int marginT; int marginB;
+    /** Tasks run in the background at batch priority, so any work of the renderer goes first */
+    TaskQueue queue;
+    bool running;
+    /** Pixels held when the tasks started */
+    int64_t heldAtStart;
+    /** mainBuffer tag and time at the last idle check, idle time only adds up while the tag stays */
+    int idleTag;
+    LARGE_INTEGER idleTime;
+    // Totals since the renderer was created
+    int64_t renderedPixels; int64_t uncoveredPixels; int64_t hitPixels;
+    int64_t idleTicks; int64_t busyTicks;
+} Prefetch;
+
+struct Renderer {
+    // User params
+    volatile int desiredWidth;
+    volatile int desiredHeight;
+    volatile double desiredZoom;
+    volatile double desiredOffsetX;
+    volatile double desiredOffsetY;
+    /** Size that desiredZoom spans, fixed when the view is chosen so that resizing keeps the pixel step */
+    volatile int desiredZoomSize;
+    /** Resizes so far and when the last one happened */
+    volatile int resizeCount;
+    LARGE_INTEGER resizeTime;
+    const Formula *volatile desiredFormula;
+    /** Last input and when it happened */
+    volatile Interaction interaction;
+    LARGE_INTEGER interactionTime;
+
+    volatile BufferArray mainBuffer;
+    volatile BufferArray swapBuffer;
+
+    // Threading
+    HANDLE statusSemaphore;
+    HANDLE bufferSemaphore;
+    volatile bool running;
+    HANDLE panThreadPointer;
+    HANDLE calculateThreadPointer;
+    /** Only touched by the calculate thread and the workers */
+    TaskQueue queue;
+    /** Only touched by the calculate thread */
+    QualityControl control;
+    Prefetch prefetch;
+    /** Decaying sum of the latest pan shifts, the border reaches further ahead in their direction */
+    volatile int recentShiftX;
+    volatile int recentShiftY;
+
+    /** Pre-rendered regions, checked before rendering a new zoom level */
+    TilePyramid *tilePyramid;
+    /** Shared memory every new state of mainBuffer is published to, only touched by the pan thread once set */
+    FrameRing *volatile frameRing;
+};
 
 // Fractal specific stuff
 int *palette = 0;
 const int maxIters = 1000;
 
-DWORD waitForBufferSemaphore(DWORD ms, char label) {
-    DWORD result = WaitForSingleObject(bufferSemaphore, ms);
+DWORD waitForBufferSemaphore(Renderer *renderer, DWORD ms, char label) {
+    DWORD result = WaitForSingleObject(renderer->bufferSemaphore, ms);
     if (DEBUG_BUFFER_SEMAPHORE)
         printf("%c Waited for bufferSemaphore: %d (%c)\n", label, result, result == 0 ? 's' : 'f');
     return result;
 }
-DWORD releaseBufferSemaphore(char label) {
+DWORD releaseBufferSemaphore(Renderer *renderer, char label) {
     long count = -1;
-    BOOL result = ReleaseSemaphore(bufferSemaphore, 1, &count);
+    BOOL result = ReleaseSemaphore(renderer->bufferSemaphore, 1, &count);
     if (DEBUG_BUFFER_SEMAPHORE)
         printf("%c Released bufferSemaphore: (%c) times %d\n", label, result != 0 ? 's' : 'f', count);
     return result;
 }
 
+/** Computer name and processor count, a profile tuned elsewhere does not apply */
+void tuningHost(char *host, int size) {
+    char name[MAX_COMPUTERNAME_LENGTH + 1] = "unknown";
+    DWORD nameSize = sizeof(name);
+    GetComputerNameA(name, &nameSize);
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    snprintf(host, size, "%s/%lu", name, (unsigned long)info.dwNumberOfProcessors);
+}
+
+bool loadTuning(const char *path, RendererTuning *loaded) {
+    FILE *file = fopen(path, "r");
+    if (!file) return false;
+    char line[256], key[64], value[192], host[192];
+    tuningHost(host, sizeof(host));
+    RendererTuning read = defaultTuning;
+    bool sameHost = false;
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "%63s %191s", key, value) != 2) continue;
+        if (strcmp(key, "host") == 0) sameHost = strcmp(value, host) == 0;
+        else if (strcmp(key, "threads") == 0) read.threads = atoi(value);
+        else if (strcmp(key, "maxTasks") == 0) read.maxTasks = atoi(value);
+        else if (strcmp(key, "panTaskPixels") == 0) read.panTaskPixels = atoi(value);
+        else if (strcmp(key, "progressiveBudgetMs") == 0) read.progressiveBudgetMs = atoi(value);
+    }
+    fclose(file);
+    if (!sameHost) {
+        if (DEBUG_TUNING) printf("%s was tuned on another machine, using defaults\n", path);
+        return false;
+    }
+    *loaded = read;
+    return true;
+}
+
+int saveTuning(const char *path, const RendererTuning *saved) {
+    FILE *file = fopen(path, "w");
+    if (!file) return 1;
+    char host[192];
+    tuningHost(host, sizeof(host));
+    fprintf(file, "host %s\nthreads %u\nmaxTasks %d\npanTaskPixels %d\nprogressiveBudgetMs %d\n",
+        host, saved->threads, saved->maxTasks, saved->panTaskPixels, saved->progressiveBudgetMs);
+    int result = ferror(file) ? 1 : 0;
+    if (fclose(file) != 0) result = 1;
+    return result;
+}
+
+unsigned int rendererThreadCount() {
+    return workerThreadCount;
+}
+
+RendererTuning rendererTuning() {
+    return tuning;
+}
+
+void rendererSetTuning(const RendererTuning *set) {
+    // Out of range values from a hand edited profile fall back to the defaults
+    tuning.threads = set->threads >= 1 && set->threads <= MAX_THREADS ? set->threads : defaultTuning.threads;
+    tuning.maxTasks = set->maxTasks >= 1 && set->maxTasks <= MAX_QUEUE ? set->maxTasks : defaultTuning.maxTasks;
+    tuning.panTaskPixels = set->panTaskPixels >= 1 ? set->panTaskPixels : defaultTuning.panTaskPixels;
+    tuning.progressiveBudgetMs = set->progressiveBudgetMs >= 1 ? set->progressiveBudgetMs : defaultTuning.progressiveBudgetMs;
+}
+
 int rendererInitialize(unsigned int inThreadCount) {
     palette = calloc(sizeof(int), (maxIters + 1) * 4);
     for (int i = 0; i < 20; i++) {
@@ -133,19 +405,20 @@ int rendererInitialize(unsigned int inThreadCount) {
         palette[i * 4 + 2] = 258 - i;
     }
 
-    statusSemaphore = CreateSemaphore(NULL, 1, 1, NULL);
-    if (!statusSemaphore) return 1;
-    bufferSemaphore = CreateSemaphore(NULL, 1, 1, NULL);
-    if (!bufferSemaphore) return 1;
+    RendererTuning loaded;
+    if (loadTuning(TUNING_PATH, &loaded)) {
+        rendererSetTuning(&loaded);
+        if (DEBUG_TUNING) printf("Loaded %s: %d threads, %d tasks, %d pixels per pan task, %dms progressive budget\n",
+            TUNING_PATH, tuning.threads, tuning.maxTasks, tuning.panTaskPixels, tuning.progressiveBudgetMs);
+    } else {
+        tuning = defaultTuning;
+    }
+
     taskSemaphore = CreateSemaphore(NULL, 1, 1, NULL);
     if (!taskSemaphore) return 1;
 
-    workerThreadCount = min(16, max(1, inThreadCount));
+    workerThreadCount = min(MAX_THREADS, max(1, inThreadCount ? inThreadCount : tuning.threads));
     threadsRunning = true;
-    panThreadPointer = (HANDLE)_beginthreadex(NULL, 0, PanThreadFunction, NULL, 0, NULL);
-    if (!panThreadPointer) return 1;
-    calculateThreadPointer = (HANDLE)_beginthreadex(NULL, 0, CalculateThreadFunction, NULL, 0, NULL);
-    if (!calculateThreadPointer) return 1;
 
     if (DEBUG_THREAD) printf("Starting %d worker threads\n", workerThreadCount);
     for (int i = 0; i < workerThreadCount; i++) {
@@ -156,453 +429,1035 @@ int rendererInitialize(unsigned int inThreadCount) {
     return 0;
 }
 
+/** Destroy every renderer first */
 void rendererExit() {
     threadsRunning = false;
     if (DEBUG_THREAD) printf("Exit awaiting threads\n");
-    if (panThreadPointer) {
-        WaitForSingleObject(panThreadPointer, INFINITE);
+    for (int i = 0; i < workerThreadCount; i++) {
+        if (workerThreadPointers[i]) {
+            WaitForSingleObject(workerThreadPointers[i], INFINITE);
+            CloseHandle(workerThreadPointers[i]);
+            workerThreadPointers[i] = 0;
+        }
     }
-    if (calculateThreadPointer) {
-        WaitForSingleObject(calculateThreadPointer, INFINITE);
+    if (taskSemaphore) CloseHandle(taskSemaphore);
+    taskSemaphore = 0;
+    if (palette) free(palette);
+    palette = 0;
+    if (DEBUG_THREAD) printf("rendererExit finished\n");
+}
+
+Renderer *rendererCreate() {
+    Renderer *renderer = calloc(1, sizeof(Renderer));
+    if (!renderer) return 0;
+    renderer->desiredWidth = 622;
+    renderer->desiredHeight = 433;
+    renderer->desiredZoom = formulas[FORMULA_MANDELBROT].zoom;
+    renderer->desiredOffsetX = formulas[FORMULA_MANDELBROT].offsetX;
+    renderer->desiredOffsetY = formulas[FORMULA_MANDELBROT].offsetY;
+    renderer->desiredFormula = &formulas[FORMULA_MANDELBROT];
+    renderer->mainBuffer.firstPassIters = renderer->swapBuffer.firstPassIters = maxIters;
+    renderer->queue.priority = RENDER_PRIORITY_INTERACTIVE;
+    renderer->prefetch.queue.priority = RENDER_PRIORITY_BATCH;
+    renderer->prefetch.idleTag = -1;
+
+    renderer->statusSemaphore = CreateSemaphore(NULL, 1, 1, NULL);
+    renderer->bufferSemaphore = CreateSemaphore(NULL, 1, 1, NULL);
+    if (!renderer->statusSemaphore || !renderer->bufferSemaphore) {
+        rendererDestroy(renderer);
+        return 0;
     }
-    if (calculateThreadPointer) {
-        WaitForMultipleObjects(workerThreadCount, workerThreadPointers, true, INFINITE);
+    renderer->running = true;
+    renderer->panThreadPointer = (HANDLE)_beginthreadex(NULL, 0, PanThreadFunction, renderer, 0, NULL);
+    renderer->calculateThreadPointer = (HANDLE)_beginthreadex(NULL, 0, CalculateThreadFunction, renderer, 0, NULL);
+    if (!renderer->panThreadPointer || !renderer->calculateThreadPointer) {
+        rendererDestroy(renderer);
+        return 0;
     }
-    if (DEBUG_THREAD) printf("Wait on buffer\n");
-    if (bufferSemaphore) {
-        waitForBufferSemaphore(INFINITE, 'E');
+    return renderer;
+}
+
+void rendererDestroy(Renderer *renderer) {
+    renderer->running = false;
+    if (DEBUG_THREAD) printf("Destroy awaiting renderer threads\n");
+    if (renderer->panThreadPointer) {
+        WaitForSingleObject(renderer->panThreadPointer, INFINITE);
+        CloseHandle(renderer->panThreadPointer);
+    }
+    if (renderer->calculateThreadPointer) {
+        WaitForSingleObject(renderer->calculateThreadPointer, INFINITE);
+        CloseHandle(renderer->calculateThreadPointer);
+    }
+    // Workers may still hold border tasks
+    if (renderer->prefetch.running) {
+        renderer->prefetch.queue.cancelled = true;
+        while (renderer->prefetch.queue.left > 0 && threadsRunning) Sleep(1);
     }
+    if (renderer->statusSemaphore) CloseHandle(renderer->statusSemaphore);
+    if (renderer->bufferSemaphore) CloseHandle(renderer->bufferSemaphore);
     if (DEBUG_THREAD) printf("Freeing buffer\n");
-    if (palette) free(palette);
-    if (mainBuffer.array) free(mainBuffer.array);
-    if (swapBuffer.array) free(swapBuffer.array);
-    if (DEBUG_THREAD) printf("rendererExit finished\n");
+    if (renderer->tilePyramid) tilePyramidClose(renderer->tilePyramid);
+    if (renderer->frameRing) frameRingClose(renderer->frameRing);
+    if (renderer->mainBuffer.array) free(renderer->mainBuffer.array);
+    if (renderer->swapBuffer.array) free(renderer->swapBuffer.array);
+    if (renderer->prefetch.array) free(renderer->prefetch.array);
+    free(renderer);
+}
+
+/** Appends a task, the queue must not be running */
+void queueTask(TaskQueue *queue, WorkerTask task) {
+    if (queue->total >= MAX_QUEUE) return;
+    queue->tasks[queue->total] = task;
+    queue->total++;
+}
+
+/**
+ * Hands the queued tasks to the worker pool without waiting, they are done once queue->left is 0.
+ * @return 1 when the pool stopped before taking them
+ */
+int startTasks(TaskQueue *queue) {
+    queue->next = 0;
+    queue->left = queue->total;
+    queue->cancelled = false;
+    queue->busyTicks = 0;
+    while (queue->left > 0) {
+        if (!threadsRunning) return 1;
+        if (WaitForSingleObject(taskSemaphore, INFINITE) != 0) return 1;
+        if (activeQueueCount < MAX_ACTIVE_QUEUES) {
+            activeQueues[activeQueueCount] = queue;
+            activeQueueCount++;
+            ReleaseSemaphore(taskSemaphore, 1, NULL);
+            break;
+        }
+        ReleaseSemaphore(taskSemaphore, 1, NULL);
+        Sleep(1);
+    }
+    return 0;
+}
+
+/**
+ * Hands the queued tasks to the worker pool and waits until they are done, then empties the queue.
+ * @return 1 when the pool stopped before finishing them
+ */
+int runTasks(TaskQueue *queue) {
+    if (startTasks(queue)) return 1;
+    while (queue->left > 0) {
+        if (!threadsRunning) return 1;
+        Sleep(1);
+    }
+    queue->total = 0;
+    return 0;
+}
+
+/**
+ * Finds rows whose mirror row across the real axis lies within [validTop, validBottom),
+ * so that they can be copied instead of calculated.
+ * Rows below the axis are the copies, that way rows keep their role while panning.
+ * @param mirrorSum Row index plus its mirror's row index
+ * @return Whether there are any such rows
+ */
+bool findMirrorRows(DesiredParams params, int validTop, int validBottom, int *mirrorStart, int *mirrorEnd, int *mirrorSum) {
+    *mirrorStart = *mirrorEnd = *mirrorSum = 0;
+    if (!params.formula->conjugateSymmetric) return false;
+    // Row py is at y = offsetY + pixelStep * (top + py), its mirror at -y. With the axis on a row or
+    // exactly halfway between two rows, the mirror of every row is another row.
+    int top = -(int)floor((float)params.height / 2);
+    double sum = -2 * params.offsetY / params.pixelStep - 2 * top;
+    if (fabs(sum - round(sum)) > 1e-6 || fabs(sum) > 4 * params.height) return false;
+    *mirrorSum = (int)round(sum);
+
+    // First row below the axis, a row exactly on it is its own mirror
+    int below = (int)floor(*mirrorSum / 2.0) + 1;
+    *mirrorStart = max(max(below, validTop), *mirrorSum - validBottom + 1);
+    *mirrorEnd = min(validBottom, *mirrorSum - validTop + 1);
+    if (*mirrorEnd <= *mirrorStart) {
+        *mirrorStart = *mirrorEnd = 0;
+        return false;
+    }
+    return true;
+}
+
+void copyMirrorRows(fracInt *array, int width, int mirrorStart, int mirrorEnd, int mirrorSum) {
+    for (int row = mirrorStart; row < mirrorEnd; row++) {
+        memcpy(array + row * width, array + (mirrorSum - row) * width, width * sizeof(fracInt));
+    }
+}
+
+/**
+ * Queues count tasks like task splitting rows [top, bottom) between them, except rows [skipStart, skipEnd).
+ */
+void queueRowTasks(TaskQueue *queue, WorkerTask task, int top, int bottom, int count, int skipStart, int skipEnd) {
+    int firstEnd = max(top, min(bottom, skipStart));
+    int secondStart = min(bottom, max(top, skipEnd));
+    if (skipEnd <= skipStart) {
+        firstEnd = secondStart = bottom;
+    }
+    int firstRows = firstEnd - top, secondRows = bottom - secondStart;
+    if (firstRows + secondRows <= 0) return;
+    count = max(firstRows > 0 && secondRows > 0 ? 2 : 1, count);
+    // Tasks proportional to the rows of each part
+    int firstCount = (int)round((double)count * firstRows / (firstRows + secondRows));
+    if (firstRows > 0) firstCount = max(1, firstCount);
+    if (secondRows > 0) firstCount = min(count - 1, firstCount);
+    int parts[2][3] = { { top, firstRows, firstCount }, { secondStart, secondRows, count - firstCount } };
+    for (int part = 0; part < 2; part++) {
+        int partTop = parts[part][0], rows = parts[part][1], tasks = parts[part][2];
+        for (int y = 0; y < tasks; y++) {
+            task.yStart = partTop + (int)round((double)rows / tasks * y);
+            task.yEnd = partTop + (int)round((double)rows / tasks * (y + 1));
+            if (task.yEnd - task.yStart == 0) continue;
+            queueTask(queue, task);
+        }
+    }
+}
+
+/** Grid after passesDone >= 1 passes, every grid pixel stands for xStep x yStep pixels */
+void progressiveGrid(int passesDone, int *xStep, int *yStep) {
+    *xStep = PROGRESSIVE_STEP >> (passesDone / 2);
+    *yStep = PROGRESSIVE_STEP >> ((passesDone - 1) / 2);
+}
+
+/** Pixels pass adds to an area, as many as the grid before it has */
+double passPixels(int pass, int area) {
+    if (pass == 0) return (double)area / (PROGRESSIVE_STEP * PROGRESSIVE_STEP);
+    int xStep, yStep;
+    progressiveGrid(pass, &xStep, &yStep);
+    return (double)area / (xStep * yStep);
+}
+
+/** Sets the task to the pixels pass adds to the grid of the passes before it, none of them calculated before */
+void setPassStriping(WorkerTask *task, int pass, int phaseX, int phaseY) {
+    task->hfillIn = task->vfillIn = false;
+    if (pass == 0) {
+        task->hstriping = task->vstriping = PROGRESSIVE_STEP;
+        task->hstripeOffset = phaseX;
+        task->vstripeOffset = phaseY;
+        return;
+    }
+    int xStep, yStep;
+    progressiveGrid(pass, &xStep, &yStep);
+    task->hstriping = xStep;
+    task->vstriping = yStep;
+    // Square grid gets the columns halfway between its columns, otherwise the rows halfway between its rows
+    task->hstripeOffset = phaseX + (xStep == yStep ? xStep / 2 : 0);
+    task->vstripeOffset = phaseY + (xStep == yStep ? 0 : yStep / 2);
+}
+
+/**
+ * Copies every grid pixel over the pixels it stands for in rows [yStart, yEnd) of the task.
+ * Pixels before the first grid row or column take the one after instead, as do rows whose grid row is skipped.
+ * Rows below the skipped rows with no grid row after theirs take the grid row of their grid row's mirror,
+ * which is what their grid row holds once the mirror is copied.
+ */
+void upsample(const WorkerTask *task) {
+    int xStep = task->hstriping, yStep = task->vstriping;
+    int width = task->width;
+    int left = -(int)floor((float)width / 2);
+    int top = -(int)floor((float)task->height / 2);
+    int firstX = task->r1xStart
+        + ((task->hstripeOffset - (left + task->r1xStart)) % xStep + xStep) % xStep;
+    if (firstX >= task->r1xEnd) return;
+
+    for (int py = task->yStart; py < task->yEnd; py++) {
+        int below = ((top + py - task->vstripeOffset) % yStep + yStep) % yStep;
+        if (below == 0 && xStep == 1) continue;
+        int gridY = py - below;
+        bool gridSkipped = gridY >= task->skipStart && gridY < task->skipEnd;
+        if (gridY < task->validTop || gridSkipped) gridY += yStep;
+        if (gridY >= task->validBottom && gridSkipped) {
+            int mirror = task->mirrorSum - (py - below);
+            gridY = mirror - ((top + mirror - task->vstripeOffset) % yStep + yStep) % yStep;
+            if (gridY < task->validTop) gridY += yStep;
+        }
+        if (gridY >= task->validBottom || (gridY >= task->skipStart && gridY < task->skipEnd)) continue;
+
+        fracInt *row = task->target + py * width, *gridRow = task->target + gridY * width;
+        for (int px = task->r1xStart; px < firstX; px++)
+            row[px] = gridRow[firstX];
+        for (int gridX = firstX; gridX < task->r1xEnd; gridX += xStep) {
+            fracInt value = gridRow[gridX];
+            int end = min(gridX + xStep, task->r1xEnd);
+            for (int px = gridY == py ? gridX + 1 : gridX; px < end; px++)
+                row[px] = value;
+        }
+    }
+}
+
+/**
+ * Copies the grid of the first passesDone passes over the pixels in between, which still hold earlier guesses.
+ * Covers rows [top, bottom) and columns [xStart, xEnd) except the mirrored rows, which are copied afterwards.
+ */
+void upsamplePasses(
+    TaskQueue *queue, fracInt *array, DesiredParams params, int passesDone, int phaseX, int phaseY,
+    int top, int bottom, int xStart, int xEnd, int mirrorStart, int mirrorEnd, int mirrorSum
+) {
+    if (passesDone >= PROGRESSIVE_PASSES) return;
+    int xStep, yStep;
+    progressiveGrid(passesDone, &xStep, &yStep);
+    WorkerTask task = { .kind = TASK_UPSAMPLE, .target = array, .width = params.width, .height = params.height,
+        .hstriping = xStep, .hstripeOffset = phaseX, .vstriping = yStep, .vstripeOffset = phaseY,
+        .r1xStart = xStart, .r1xEnd = xEnd, .validTop = top, .validBottom = bottom,
+        .skipStart = mirrorStart, .skipEnd = mirrorEnd, .mirrorSum = mirrorSum };
+    queueRowTasks(queue, task, top, bottom, workerThreadCount * 2, mirrorStart, mirrorEnd);
+    runTasks(queue);
 }
 
 /** Only use with status semaphore */
-double getCurrentPixelStep() {
-    return desiredZoom * 2 / min(desiredWidth, desiredHeight);
+double getCurrentPixelStep(Renderer *renderer) {
+    return renderer->desiredZoom * 2
+        / (renderer->desiredZoomSize ? renderer->desiredZoomSize : min(renderer->desiredWidth, renderer->desiredHeight));
 }
 
-DesiredParams getCurrentDesired() {
+DesiredParams getCurrentDesired(Renderer *renderer) {
     return (DesiredParams){
-        desiredWidth, desiredHeight,
-        getCurrentPixelStep(),
-        desiredOffsetX, desiredOffsetY,
+        renderer->desiredWidth, renderer->desiredHeight,
+        getCurrentPixelStep(renderer),
+        renderer->desiredOffsetX, renderer->desiredOffsetY,
+        renderer->desiredFormula,
     };
 }
 
+/** Only use with status semaphore */
+void setInteraction(Renderer *renderer, Interaction interaction) {
+    renderer->interaction = interaction;
+    QueryPerformanceCounter(&renderer->interactionTime);
+}
+
+/** Only use with status semaphore, INTERACTION_NONE once the last input is IDLE_MS old */
+Interaction getInteraction(Renderer *renderer) {
+    LARGE_INTEGER perfFrequency, perfNow;
+    QueryPerformanceFrequency(&perfFrequency);
+    QueryPerformanceCounter(&perfNow);
+    if ((perfNow.QuadPart - renderer->interactionTime.QuadPart) * 1000 / perfFrequency.QuadPart >= IDLE_MS)
+        return INTERACTION_NONE;
+    return renderer->interaction;
+}
+
+/**
+ * Share of the iterations in a sample of array that are left with a limit of iters,
+ * each pixel counting one more for its overhead. Predicts how much a cap saves on a similar view.
+ */
+double itersFraction(const fracInt *array, int count, int iters) {
+    if (!array || iters >= maxIters) return 1;
+    uint64_t total = 0, capped = 0;
+    for (int i = 0; i < count; i += ITERS_SAMPLE_STRIDE) {
+        total += array[i] + 1;
+        capped += min(array[i], iters) + 1;
+    }
+    return total ? (double)capped / total : 1;
+}
+
+/**
+ * Updates the cost model with a step that calculated pixels in ms, and the statistics if it was interactive.
+ * @param fraction Predicted itersFraction of the iteration limit
+ * @param pixelShare Share of the shown frame calculated afterwards, the rest is guessed or missing
+ */
+int deadlineMs(Interaction interaction) {
+    return interaction == INTERACTION_NONE ? tuning.progressiveBudgetMs : interactionDeadlines[interaction];
+}
+
+void recordStep(QualityControl *control, Interaction interaction, double ms, double pixels, double fraction, double pixelShare, int iters) {
+    if (pixels > 0 && ms > 0) {
+        double pixelNanos = ms * 1e6 / (pixels * fraction);
+        control->pixelNanos = control->pixelNanos > 0 ? (control->pixelNanos + pixelNanos) / 2 : pixelNanos;
+    }
+    if (interaction == INTERACTION_NONE) return;
+    control->steps++;
+    if (ms <= deadlineMs(interaction)) control->hits++;
+    control->pixelQuality += pixelShare;
+    control->itersQuality += (double)iters / maxIters;
+    if (DEBUG_QUALITY) {
+        printf("%s step %.1fms of %dms, %.0f%% of pixels at %d iterations; deadlines met %d/%d, average quality %.0f%% pixels %.0f%% iterations\n",
+            interactionNames[interaction], ms, deadlineMs(interaction), pixelShare * 100, iters,
+            control->hits, control->steps, control->pixelQuality * 100 / control->steps, control->itersQuality * 100 / control->steps);
+    }
+}
+
+/** Sets buffer size, only reallocating when it does not fit in the capacity */
+void reserveBuffer(volatile BufferArray *buffer, int width, int height) {
+    if (!buffer->array || width * height > buffer->capacity) {
+        buffer->capacity = (int)(width * height * BUFFER_HEADROOM);
+        buffer->array = realloc(buffer->array, buffer->capacity * sizeof(fracInt));
+    }
+    buffer->params.width = width;
+    buffer->params.height = height;
+}
+
+/**
+ * Resizes the buffer around the view center, keeping what content still fits.
+ * New area is left missing like after a pan and cleared, the progressive grid stays as the center does not move.
+ */
+void resizeBuffer(volatile BufferArray *buffer, int width, int height) {
+    int oldWidth = buffer->params.width, oldHeight = buffer->params.height;
+    // Pixel px is at offsetX + pixelStep * (px - floor(width / 2))
+    int shiftX = (int)floor((float)width / 2) - (int)floor((float)oldWidth / 2);
+    int shiftY = (int)floor((float)height / 2) - (int)floor((float)oldHeight / 2);
+    reserveBuffer(buffer, width, max(height, oldHeight));
+    fracInt *array = buffer->array;
+
+    // Change row length first, rows move away from the start when growing and towards it when shrinking
+    int rowLength = min(width, oldWidth);
+    int sourceX = shiftX < 0 ? -shiftX : 0;
+    int targetX = shiftX > 0 ? shiftX : 0;
+    if (width > oldWidth) {
+        for (int y = oldHeight - 1; y >= 0; y--) {
+            memmove(array + y * width + targetX, array + y * oldWidth + sourceX, rowLength * sizeof(fracInt));
+            memset(array + y * width, 0, targetX * sizeof(fracInt));
+            memset(array + y * width + targetX + rowLength, 0, (width - targetX - rowLength) * sizeof(fracInt));
+        }
+    } else if (width < oldWidth) {
+        for (int y = 0; y < oldHeight; y++) {
+            memmove(array + y * width + targetX, array + y * oldWidth + sourceX, rowLength * sizeof(fracInt));
+        }
+    }
+    // Then move rows
+    if (shiftY > 0) {
+        for (int y = min(height, oldHeight + shiftY) - 1; y >= shiftY; y--) {
+            memcpy(array + y * width, array + (y - shiftY) * width, width * sizeof(fracInt));
+        }
+        memset(array, 0, shiftY * width * sizeof(fracInt));
+    } else if (shiftY < 0) {
+        for (int y = 0; y < min(height, oldHeight + shiftY); y++) {
+            memcpy(array + y * width, array + (y - shiftY) * width, width * sizeof(fracInt));
+        }
+    }
+    if (oldHeight + shiftY < height) {
+        memset(array + (oldHeight + shiftY) * width, 0, (height - oldHeight - shiftY) * width * sizeof(fracInt));
+    }
+    buffer->params.height = height;
+
+    buffer->missingL = max(0, buffer->missingL + shiftX);
+    buffer->missingR = max(0, buffer->missingR + width - oldWidth - shiftX);
+    buffer->missingT = max(0, buffer->missingT + shiftY);
+    buffer->missingB = max(0, buffer->missingB + height - oldHeight - shiftY);
+    buffer->mirrorStart = max(0, min(height, buffer->mirrorStart + shiftY));
+    buffer->mirrorEnd = max(0, min(height, buffer->mirrorEnd + shiftY));
+}
+
+/** Whether the border lies on the pixel grid of view */
+bool prefetchMatches(const Prefetch *prefetch, DesiredParams view, Precision precision) {
+    return prefetch->array && prefetch->view.pixelStep == view.pixelStep && prefetch->view.formula == view.formula
+        && prefetch->precision == precision;
+}
+
+/** Border pixel that pixel (0, 0) of view on the same pixel grid lies at */
+void prefetchOrigin(const Prefetch *prefetch, DesiredParams view, int *x, int *y) {
+    *x = prefetch->marginL + prefetch->view.width / 2 - view.width / 2
+        - (int)round((prefetch->view.offsetX - view.offsetX) / view.pixelStep);
+    *y = prefetch->marginT + prefetch->view.height / 2 - view.height / 2
+        - (int)round((prefetch->view.offsetY - view.offsetY) / view.pixelStep);
+}
+
+/** Copies pixels [x0, x1) of row y of array from the border, false when any of them is not rendered */
+bool copyPrefetchedRow(const Prefetch *prefetch, int originX, int originY, fracInt *array, int width, int y, int x0, int x1) {
+    if (y + originY < 0 || y + originY >= prefetch->height || x0 + originX < 0 || x1 + originX > prefetch->width) return false;
+    const fracInt *source = prefetch->array + (y + originY) * prefetch->width + originX;
+    for (int x = x0; x < x1; x++) {
+        // Workers may still be writing it, a pixel only ever changes from PREFETCH_EMPTY to its value
+        fracInt value = source[x];
+        if (value == PREFETCH_EMPTY) return false;
+        array[y * width + x] = value;
+    }
+    return true;
+}
+
+/** Copies rows [y0, y1) of column x of array from the border, false when any of them is not rendered */
+bool copyPrefetchedColumn(const Prefetch *prefetch, int originX, int originY, fracInt *array, int width, int x, int y0, int y1) {
+    if (x + originX < 0 || x + originX >= prefetch->width || y0 + originY < 0 || y1 + originY > prefetch->height) return false;
+    for (int y = y0; y < y1; y++) {
+        fracInt value = prefetch->array[(y + originY) * prefetch->width + x + originX];
+        if (value == PREFETCH_EMPTY) return false;
+        array[y * width + x] = value;
+    }
+    return true;
+}
+
+/**
+ * Copies what the border holds of the missing strips of array into it, then shrinks the strips
+ * by the rows and columns next to the content that are whole now.
+ */
+void fillFromPrefetch(Prefetch *prefetch, fracInt *array, DesiredParams view, Precision precision,
+    int *missingL, int *missingR, int *missingT, int *missingB) {
+    int width = view.width, height = view.height;
+    int uncovered = width * height - (width - *missingL - *missingR) * (height - *missingT - *missingB);
+    prefetch->uncoveredPixels += uncovered;
+    if (!prefetchMatches(prefetch, view, precision)) return;
+
+    int originX, originY;
+    prefetchOrigin(prefetch, view, &originX, &originY);
+    // Whole rows above and below the content first, then columns beside it over those rows
+    int top = *missingT, bottom = height - *missingB;
+    while (top > 0 && copyPrefetchedRow(prefetch, originX, originY, array, width, top - 1, 0, width)) top--;
+    while (bottom < height && copyPrefetchedRow(prefetch, originX, originY, array, width, bottom, 0, width)) bottom++;
+    int left = *missingL, right = width - *missingR;
+    while (left > 0 && copyPrefetchedColumn(prefetch, originX, originY, array, width, left - 1, top, bottom)) left--;
+    while (right < width && copyPrefetchedColumn(prefetch, originX, originY, array, width, right, top, bottom)) right++;
+    *missingL = left; *missingR = width - right;
+    *missingT = top; *missingB = height - bottom;
+
+    int hits = uncovered - (width * height - (right - left) * (bottom - top));
+    prefetch->hitPixels += hits;
+    if (DEBUG_PREFETCH >= 2) printf("%d of %d uncovered pixels were prefetched\n", hits, uncovered);
+}
+
+/** Border pixels rendered or copied so far */
+int64_t countPrefetched(const Prefetch *prefetch) {
+    int64_t count = 0;
+    for (int i = 0; i < prefetch->width * prefetch->height; i++) count += prefetch->array[i] != PREFETCH_EMPTY;
+    return count;
+}
+
+/** Whether pixels [x0, x1) x [y0, y1) of the border are rendered */
+bool prefetchedRect(const Prefetch *prefetch, int x0, int x1, int y0, int y1) {
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            if (prefetch->array[y * prefetch->width + x] == PREFETCH_EMPTY) return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Sets the border up around the complete mainBuffer, keeping what the previous border holds of it,
+ * and hands the parts still missing to the workers from the view outward.
+ * Call holding the buffer semaphore while no border tasks run.
+ */
+void startPrefetch(Renderer *renderer) {
+    Prefetch *prefetch = &renderer->prefetch;
+    DesiredParams view = renderer->mainBuffer.params;
+    Precision precision = renderer->mainBuffer.precision;
+    // Panning to the right uncovers the left side
+    int marginL = renderer->recentShiftX > 0 ? PREFETCH_MARGIN_AHEAD : PREFETCH_MARGIN;
+    int marginR = renderer->recentShiftX < 0 ? PREFETCH_MARGIN_AHEAD : PREFETCH_MARGIN;
+    int marginT = renderer->recentShiftY > 0 ? PREFETCH_MARGIN_AHEAD : PREFETCH_MARGIN;
+    int marginB = renderer->recentShiftY < 0 ? PREFETCH_MARGIN_AHEAD : PREFETCH_MARGIN;
+    int width = view.width + marginL + marginR, height = view.height + marginT + marginB;
+    fracInt *array = malloc((size_t)width * height * sizeof(fracInt));
+    if (!array) return;
+    memset(array, 0xff, (size_t)width * height * sizeof(fracInt));
+
+    if (prefetchMatches(prefetch, view, precision)) {
+        int originX, originY;
+        prefetchOrigin(prefetch, view, &originX, &originY);
+        // Pixel (x, y) of the new border is (x + shiftX, y + shiftY) of the old one
+        int shiftX = originX - marginL, shiftY = originY - marginT;
+        int x0 = max(0, -shiftX), x1 = min(width, prefetch->width - shiftX);
+        int y0 = max(0, -shiftY), y1 = min(height, prefetch->height - shiftY);
+        for (int y = y0; y < y1 && x0 < x1; y++) {
+            memcpy(array + y * width + x0, prefetch->array + (y + shiftY) * prefetch->width + x0 + shiftX, (x1 - x0) * sizeof(fracInt));
+        }
+    }
+    for (int y = 0; y < view.height; y++) {
+        memcpy(array + (y + marginT) * width + marginL, renderer->mainBuffer.array + y * view.width, view.width * sizeof(fracInt));
+    }
+    free(prefetch->array);
+    prefetch->array = array;
+    prefetch->width = width; prefetch->height = height;
+    prefetch->view = view;
+    prefetch->precision = precision;
+    prefetch->marginL = marginL; prefetch->marginR = marginR;
+    prefetch->marginT = marginT; prefetch->marginB = marginB;
+    prefetch->heldAtStart = countPrefetched(prefetch);
+
+    // The border's own center, so that its pixels lie on the view's grid
+    double centerX = view.offsetX + view.pixelStep * (width / 2 - marginL - view.width / 2);
+    double centerY = view.offsetY + view.pixelStep * (height / 2 - marginT - view.height / 2);
+    WorkerTask task = (WorkerTask){view.formula->calculate[precision], array, maxIters,
+        view.formula->paramR, view.formula->paramI,
+        centerX, centerY, view.pixelStep, width, height,
+        0, 0, false, 0, 0, false,
+        0, 0, 0, 0, false, 0, 0};
+    for (int ring = 0; ring < PREFETCH_RINGS; ring++) {
+        // Edges of the view grown by ring and by ring + 1 parts of the margins
+        int innerL = marginL - marginL * ring / PREFETCH_RINGS, outerL = marginL - marginL * (ring + 1) / PREFETCH_RINGS;
+        int innerT = marginT - marginT * ring / PREFETCH_RINGS, outerT = marginT - marginT * (ring + 1) / PREFETCH_RINGS;
+        int innerR = width - marginR + marginR * ring / PREFETCH_RINGS, outerR = width - marginR + marginR * (ring + 1) / PREFETCH_RINGS;
+        int innerB = height - marginB + marginB * ring / PREFETCH_RINGS, outerB = height - marginB + marginB * (ring + 1) / PREFETCH_RINGS;
+        // Top and bottom span the ring's corners, left and right lie between them
+        int sides[4][4] = {
+            { outerL, outerR, outerT, innerT },
+            { outerL, outerR, innerB, outerB },
+            { outerL, innerL, innerT, innerB },
+            { innerR, outerR, innerT, innerB },
+        };
+        for (int side = 0; side < 4; side++) {
+            int x0 = sides[side][0], x1 = sides[side][1], y0 = sides[side][2], y1 = sides[side][3];
+            if (x0 >= x1 || y0 >= y1 || prefetchedRect(prefetch, x0, x1, y0, y1)) continue;
+            task.r1xStart = x0;
+            task.r1xEnd = x1;
+            queueRowTasks(&prefetch->queue, task, y0, y1, PREFETCH_SIDE_TASKS, 0, 0);
+        }
+    }
+    if (prefetch->queue.total == 0) return;
+    startTasks(&prefetch->queue);
+    prefetch->running = true;
+}
+
+/** Adds up the statistics once all border tasks are done */
+void finishPrefetch(Prefetch *prefetch) {
+    prefetch->running = false;
+    prefetch->queue.total = 0;
+    prefetch->renderedPixels += countPrefetched(prefetch) - prefetch->heldAtStart;
+    prefetch->busyTicks += prefetch->queue.busyTicks;
+    if (DEBUG_PREFETCH) {
+        printf("Prefetched %lld border pixels in total, using %.0f%% of idle worker time; %lld of %lld uncovered pixels (%.0f%%) came from the border\n",
+            (long long)prefetch->renderedPixels,
+            prefetch->idleTicks ? 100.0 * prefetch->busyTicks / ((double)prefetch->idleTicks * workerThreadCount) : 0,
+            (long long)prefetch->hitPixels, (long long)prefetch->uncoveredPixels,
+            prefetch->uncoveredPixels ? 100.0 * prefetch->hitPixels / prefetch->uncoveredPixels : 0);
+    }
+}
+
 /**
  * Does simple panning of the mainBuffer and retrieves swapBuffer when ready
  */
 unsigned __stdcall PanThreadFunction( void* pArguments ) {
+    Renderer *renderer = pArguments;
+    LARGE_INTEGER perfFrequency, perfNow;
+    QueryPerformanceFrequency(&perfFrequency);
+
     int currentTag = 0;
-    while (threadsRunning) {
+    int completedResize = 0;
+    int exportedTag = 0;
+    while (renderer->running) {
         Sleep(3);
-        if (WaitForSingleObject(statusSemaphore, 1000) != 0) continue;
-        DesiredParams target = getCurrentDesired();
-        ReleaseSemaphore(statusSemaphore, 1, NULL);
+        if (WaitForSingleObject(renderer->statusSemaphore, 1000) != 0) continue;
+        DesiredParams target = getCurrentDesired(renderer);
+        int currentResize = renderer->resizeCount;
+        LARGE_INTEGER currentResizeTime = renderer->resizeTime;
+        ReleaseSemaphore(renderer->statusSemaphore, 1, NULL);
 
-        if (waitForBufferSemaphore(3, 'P') != 0) {
+        if (waitForBufferSemaphore(renderer, 3, 'P') != 0) {
             continue;
         }
         
-        // swapBuffer processed and ready
-        if (swapBuffer.wip == 0) {
+        // renderer->swapBuffer processed and ready
+        if (renderer->swapBuffer.wip == 0) {
             MemoryBarrier();
-            if (swapBuffer.freshlyCalculated) {
+            if (renderer->swapBuffer.freshlyCalculated) {
                 if (DEBUG_THREAD >= 2) printf("Swap!!\n");
                 currentTag++;
 
-                BufferArray oldSwap = swapBuffer;
-                swapBuffer = mainBuffer;
-                mainBuffer = oldSwap;
-                if (DEBUG_STRIPING >= 2) printf("Progress on main after swap: {%c%c%c}{%c%c%c}{%c%c%c}\n",
-                    mainBuffer.stripeProgress[0][0]?'-':' ', mainBuffer.stripeProgress[0][1]?'-':' ', mainBuffer.stripeProgress[0][2]?'-':' ',
-                    mainBuffer.stripeProgress[1][0]?'-':' ', mainBuffer.stripeProgress[1][1]?'-':' ', mainBuffer.stripeProgress[1][2]?'-':' ',
-                    mainBuffer.stripeProgress[2][0]?'-':' ', mainBuffer.stripeProgress[2][1]?'-':' ', mainBuffer.stripeProgress[2][2]?'-':' ');
-                mainBuffer.freshlyCalculated = false;
-                mainBuffer.tag = currentTag;
+                BufferArray oldSwap = renderer->swapBuffer;
+                renderer->swapBuffer = renderer->mainBuffer;
+                renderer->mainBuffer = oldSwap;
+                if (DEBUG_STRIPING >= 2) printf("Passes on main after swap: %d/%d\n",
+                    renderer->mainBuffer.passesDone, PROGRESSIVE_PASSES);
+                renderer->mainBuffer.freshlyCalculated = false;
+                renderer->mainBuffer.tag = currentTag;
             }
         }
-        if (mainBuffer.array) {
-            // Pan mainBuffer
-            if (target.offsetX != mainBuffer.params.offsetX || target.offsetY != mainBuffer.params.offsetY) {
+        if (renderer->mainBuffer.array) {
+            // Pan renderer->mainBuffer
+            if (target.offsetX != renderer->mainBuffer.params.offsetX || target.offsetY != renderer->mainBuffer.params.offsetY) {
                 currentTag++;
 
-                int shiftX = (int)round((mainBuffer.params.offsetX - target.offsetX) / target.pixelStep);
-                int shiftY = (int)round((mainBuffer.params.offsetY - target.offsetY) / target.pixelStep);
+                int shiftX = (int)round((renderer->mainBuffer.params.offsetX - target.offsetX) / target.pixelStep);
+                int shiftY = (int)round((renderer->mainBuffer.params.offsetY - target.offsetY) / target.pixelStep);
+                renderer->recentShiftX = renderer->recentShiftX / 2 + shiftX;
+                renderer->recentShiftY = renderer->recentShiftY / 2 + shiftY;
                 if (shiftX > 0) {
-                    mainBuffer.missingL += shiftX;
+                    renderer->mainBuffer.missingL += shiftX;
                 } else if (shiftX < 0) {
-                    mainBuffer.missingR += -shiftX;
+                    renderer->mainBuffer.missingR += -shiftX;
                 }
                 if (shiftY > 0) {
-                    mainBuffer.missingT += shiftY;
+                    renderer->mainBuffer.missingT += shiftY;
                 } else if (shiftY < 0) {
-                    mainBuffer.missingB += -shiftY;
+                    renderer->mainBuffer.missingB += -shiftY;
                 }
-                mainBuffer.params.offsetX = target.offsetX;
-                mainBuffer.params.offsetY = target.offsetY;
-                mainBuffer.tag = currentTag;
-
-                // Shift stripe progress
-                if (!striping_done(mainBuffer.stripeProgress)) {
-                    int cols = (shiftX + STRIPING * 10000) % STRIPING;
-                    int rows = (shiftY + STRIPING * 10000) % STRIPING;
-                    bool *progress = (bool*)mainBuffer.stripeProgress;
-                    if (cols != 0) {
-                        bool tmp[STRIPING - 1];
-                        for (size_t y = 0; y < STRIPING; y++) {
-                            bool *progress = (bool*)mainBuffer.stripeProgress;
-                            memcpy(tmp, progress + STRIPING - cols, cols * sizeof(bool));
-                            memmove(progress + cols, progress, (STRIPING - cols) * sizeof(bool));
-                            memcpy(progress, tmp, cols * sizeof(bool));
-                        }
-                    }
-                    if (rows != 0) {
-                        bool tmp[STRIPING - 1][STRIPING];
-                        memcpy(tmp, progress + (STRIPING - rows) * STRIPING, rows * STRIPING * sizeof(bool));
-                        memmove(progress + rows * STRIPING, progress, (STRIPING - rows) * STRIPING * sizeof(bool));
-                        memcpy(progress, tmp, rows * STRIPING * sizeof(bool));
-                    }
+                renderer->mainBuffer.params.offsetX = target.offsetX;
+                renderer->mainBuffer.params.offsetY = target.offsetY;
+                renderer->mainBuffer.tag = currentTag;
+
+                // Mirrored rows move with the content, once all passes are done they are plain finished rows
+                if (!progressive_done(renderer->mainBuffer)) {
+                    renderer->mainBuffer.mirrorStart = max(0, min(renderer->mainBuffer.params.height, renderer->mainBuffer.mirrorStart + shiftY));
+                    renderer->mainBuffer.mirrorEnd = max(0, min(renderer->mainBuffer.params.height, renderer->mainBuffer.mirrorEnd + shiftY));
+                } else {
+                    renderer->mainBuffer.mirrorStart = renderer->mainBuffer.mirrorEnd = 0;
                 }
+
+                // Grid moves with the content
+                renderer->mainBuffer.phaseX = (renderer->mainBuffer.phaseX + shiftX + PROGRESSIVE_STEP * 10000) % PROGRESSIVE_STEP;
+                renderer->mainBuffer.phaseY = (renderer->mainBuffer.phaseY + shiftY + PROGRESSIVE_STEP * 10000) % PROGRESSIVE_STEP;
                 
                 // Pan the buffer array (move the content data based on pan)
                 if (!(
-                    mainBuffer.missingL >= mainBuffer.params.width || mainBuffer.missingR >= mainBuffer.params.width
-                    || mainBuffer.missingT >= mainBuffer.params.height || mainBuffer.missingB >= mainBuffer.params.height
+                    renderer->mainBuffer.missingL >= renderer->mainBuffer.params.width || renderer->mainBuffer.missingR >= renderer->mainBuffer.params.width
+                    || renderer->mainBuffer.missingT >= renderer->mainBuffer.params.height || renderer->mainBuffer.missingB >= renderer->mainBuffer.params.height
                 )) {
                     if (DEBUG_PANNING) printf("Panning by x: %d; y: %d!!\n", shiftX, shiftY);
-                    int width = mainBuffer.params.width;
+                    int width = renderer->mainBuffer.params.width;
                     int rowLength = width - abs(shiftX);
                     int sourceX = shiftX > 0 ? 0 : -shiftX;
                     int targetX = shiftX > 0 ? shiftX : 0;
                     if (shiftY >= 0) {
-                        int targetY = mainBuffer.params.height - 1;
+                        int targetY = renderer->mainBuffer.params.height - 1;
                         int sourceY = targetY - shiftY;
                         for (; sourceY >= 0; sourceY--, targetY--) {
                             memmove(
-                                mainBuffer.array + (targetY * width + targetX),
-                                mainBuffer.array + (sourceY * width + sourceX),
+                                renderer->mainBuffer.array + (targetY * width + targetX),
+                                renderer->mainBuffer.array + (sourceY * width + sourceX),
                                 rowLength * sizeof(fracInt)
                             );
                         }
                     } else {
                         int targetY = 0;
                         int sourceY = -shiftY;
-                        for (; sourceY < mainBuffer.params.height; sourceY++, targetY++) {
+                        for (; sourceY < renderer->mainBuffer.params.height; sourceY++, targetY++) {
                             memmove(
-                                mainBuffer.array + (targetY * width + targetX),
-                                mainBuffer.array + (sourceY * width + sourceX),
+                                renderer->mainBuffer.array + (targetY * width + targetX),
+                                renderer->mainBuffer.array + (sourceY * width + sourceX),
                                 rowLength * sizeof(fracInt)
                             );
                         }
                     }
                 }
             }
+
+            // Crop or extend renderer->mainBuffer to the new size instead of waiting on a rerender
+            if ((target.width != renderer->mainBuffer.params.width || target.height != renderer->mainBuffer.params.height)
+                && target.width > 0 && target.height > 0) {
+                currentTag++;
+                if (DEBUG_PANNING) printf("Resizing from %dx%d to %dx%d!!\n",
+                    renderer->mainBuffer.params.width, renderer->mainBuffer.params.height, target.width, target.height);
+                resizeBuffer(&renderer->mainBuffer, target.width, target.height);
+                renderer->mainBuffer.tag = currentTag;
+            }
+
+            // Time from the last resize until the frame at that size is complete
+            if (currentResize != completedResize && renderer->mainBuffer.params.width == target.width && renderer->mainBuffer.params.height == target.height
+                && renderer->mainBuffer.params.pixelStep == target.pixelStep && progressive_done(renderer->mainBuffer)
+                && !renderer->mainBuffer.missingL && !renderer->mainBuffer.missingR && !renderer->mainBuffer.missingT && !renderer->mainBuffer.missingB) {
+                completedResize = currentResize;
+                QueryPerformanceCounter(&perfNow);
+                if (DEBUG_TIME) printf("Resize to %dx%d complete after %dms\n", target.width, target.height,
+                    (int)((perfNow.QuadPart * 1000 - currentResizeTime.QuadPart * 1000) / perfFrequency.QuadPart));
+            }
+
+            // Every change of renderer->mainBuffer is a new frame for readers of the frame ring
+            if (renderer->frameRing && renderer->mainBuffer.tag != exportedTag) {
+                exportedTag = renderer->mainBuffer.tag;
+                exportFrame(renderer);
+            }
         }
-        releaseBufferSemaphore('P');
+        releaseBufferSemaphore(renderer, 'P');
     }
     if (DEBUG_THREAD) printf("Finishing PanThreadFunction\n");
     return 0;
 }
 
-void reallocSwapBuffer(int width, int height) {
-    swapBuffer.array = realloc(swapBuffer.array, width * height * sizeof(fracInt));
-    swapBuffer.params.width = width;
-    swapBuffer.params.height = height;
-}
-
 /**
- * Does fractal calculations in swapBuffer
+ * Does fractal calculations in renderer->swapBuffer
  */
 unsigned __stdcall CalculateThreadFunction( void* pArguments ) {
+    Renderer *renderer = pArguments;
+    TaskQueue *queue = &renderer->queue;
+    QualityControl *control = &renderer->control;
     LARGE_INTEGER perfFrequency, perfStart, perfEnd;
     QueryPerformanceFrequency(&perfFrequency);
 
     int lastTouchedTag = -1;
-    while (threadsRunning) {
+    while (renderer->running) {
         // Get desired user params
         Sleep(3);
-        if (WaitForSingleObject(statusSemaphore, 1000) != 0) continue;
-        DesiredParams target = getCurrentDesired();
-        ReleaseSemaphore(statusSemaphore, 1, NULL);
+        if (WaitForSingleObject(renderer->statusSemaphore, 1000) != 0) continue;
+        DesiredParams target = getCurrentDesired(renderer);
+        Interaction interaction = getInteraction(renderer);
+        ReleaseSemaphore(renderer->statusSemaphore, 1, NULL);
+        double deadlineNanos = deadlineMs(interaction) * 1e6;
 
         if (target.width < 4 && target.height < 4) {
             continue;
         }
         
         // WaitForSingleObject(bufferSemaphore, 5)
-        if (waitForBufferSemaphore(5, 'C') != 0) {
+        if (waitForBufferSemaphore(renderer, 5, 'C') != 0) {
             continue;
         }
 
         // Buffer is still the same, wait for pan thread to acknowledge (and process) the swap
-        if (lastTouchedTag == mainBuffer.tag) {
-            releaseBufferSemaphore('C');
+        if (lastTouchedTag == renderer->mainBuffer.tag) {
+            releaseBufferSemaphore(renderer, 'C');
             continue;
         }
 
-        // Zoom level is different, rerender from scratch
-        if (target.pixelStep != mainBuffer.params.pixelStep) {
-            lastTouchedTag = mainBuffer.tag;
-            if (!swapBuffer.array || swapBuffer.params.width != target.width || swapBuffer.params.height != target.height) {
-                reallocSwapBuffer(target.width, target.height);
+        // Zoom level or formula is different, rerender from scratch
+        if (target.pixelStep != renderer->mainBuffer.params.pixelStep || target.formula != renderer->mainBuffer.params.formula) {
+            lastTouchedTag = renderer->mainBuffer.tag;
+            // The border around the old view is of no use anymore
+            renderer->prefetch.queue.cancelled = true;
+            reserveBuffer(&renderer->swapBuffer, target.width, target.height);
+            fracInt *swapArray = renderer->swapBuffer.array;
+
+            // As many passes as fit the deadline, with the last frame's iterations predicting how much capping the first one saves
+            int area = target.width * target.height;
+            int passes = 1, firstPassIters = maxIters;
+            double pixels = passPixels(0, area), fraction = 1;
+            while (control->pixelNanos > 0 && passes < PROGRESSIVE_PASSES
+                && (pixels + passPixels(passes, area)) * control->pixelNanos <= deadlineNanos) {
+                pixels += passPixels(passes, area);
+                passes++;
+            }
+            while (interaction != INTERACTION_NONE && firstPassIters / 2 >= MIN_ITERS_CAP
+                && pixels * control->pixelNanos * fraction > deadlineNanos) {
+                firstPassIters /= 2;
+                fraction = itersFraction(renderer->mainBuffer.array,
+                    renderer->mainBuffer.params.width * renderer->mainBuffer.params.height, firstPassIters);
             }
-            fracInt *swapArray = swapBuffer.array;
             MemoryBarrier();
             // While wip is set to > 0, main/pan threads aren't allowed to touch it
-            swapBuffer.wip = 1;
+            renderer->swapBuffer.wip = 1;
             // ReleaseSemaphore(bufferSemaphore, 1, NULL)
-            releaseBufferSemaphore('C');
+            releaseBufferSemaphore(renderer, 'C');
 
             if (DEBUG_THREAD >= 2) printf("Calculating scale!!\n");
 
-            // Schedule task regions
-            if (WaitForSingleObject(taskSemaphore, INFINITE) != 0) {
-                fprintf(stderr, "Calculate thread could not acquire task semaphore\n");
-                continue;
-            }
+            bool precisionExhausted;
+            Precision precision = choosePrecision(target.formula, maxIters,
+                target.offsetX, target.offsetY, target.pixelStep, target.width, target.height, &precisionExhausted);
+            if (precisionExhausted) printf("Precision exhausted, pixels are no longer distinct\n");
 
-            tasksTotal = min(MAX_QUEUE, target.height * 3);
-            tasksLeft = 0;
-            for (int y = 0; y < tasksTotal; y++) {
-                int top = (int)round((double)target.height / tasksTotal * y);
-                int bottom = (int)round((double)target.height / tasksTotal * (y + 1));
-                taskQueue[tasksLeft] = (WorkerTask){false, swapArray, maxIters,
-                    target.offsetX, target.offsetY, target.pixelStep, target.width, target.height,
-                    STRIPING, 0, true, STRIPING, 0, true,
-                    top, bottom, 0, target.width, false, 0, 0};
-                tasksLeft++;
-            }
+            // Known view, page it in from the tile pyramid instead
+            int mirrorStart = 0, mirrorEnd = 0, mirrorSum = 0;
             QueryPerformanceCounter(&perfStart);
-            ReleaseSemaphore(taskSemaphore, 1, NULL);
-
-            while (tasksLeft >= 1) {
-                Sleep(3);
+            bool pagedIn = renderer->tilePyramid && target.formula == &formulas[FORMULA_MANDELBROT] && tilePyramidFill(renderer->tilePyramid, swapArray, maxIters,
+                target.offsetX, target.offsetY, target.pixelStep, target.width, target.height);
+            if (!pagedIn) {
+                // Rows mirroring others across the real axis are copied afterwards
+                findMirrorRows(target, 0, target.height, &mirrorStart, &mirrorEnd, &mirrorSum);
+                // First passes, upsampled so that the frame is complete
+                int tasksTotal = min(tuning.maxTasks, target.height * 3);
+                for (int pass = 0; pass < passes; pass++) {
+                    WorkerTask task = (WorkerTask){target.formula->calculate[precision], swapArray, pass ? maxIters : firstPassIters,
+                        target.formula->paramR, target.formula->paramI,
+                        target.offsetX, target.offsetY, target.pixelStep, target.width, target.height,
+                        0, 0, false, 0, 0, false,
+                        0, 0, 0, target.width, false, 0, 0};
+                    setPassStriping(&task, pass, 0, 0);
+                    queueRowTasks(queue, task, 0, target.height, (tasksTotal - queue->total) / (passes - pass), mirrorStart, mirrorEnd);
+                }
+                QueryPerformanceCounter(&perfStart);
+                runTasks(queue);
+                upsamplePasses(queue, swapArray, target, passes, 0, 0, 0, target.height, 0, target.width, mirrorStart, mirrorEnd, mirrorSum);
+                copyMirrorRows(swapArray, target.width, mirrorStart, mirrorEnd, mirrorSum);
+            } else {
+                passes = PROGRESSIVE_PASSES;
+                firstPassIters = maxIters;
             }
             
             QueryPerformanceCounter(&perfEnd);
-            swapBuffer.rowMicros = (perfEnd.QuadPart * 1000000 - perfStart.QuadPart * 1000000) / perfFrequency.QuadPart;
+            double ms = (double)(perfEnd.QuadPart - perfStart.QuadPart) * 1000 / perfFrequency.QuadPart;
             if (DEBUG_TIME) {
-                printf("Calculating scale took %dms\n", (perfEnd.QuadPart * 1000 - perfStart.QuadPart * 1000) / perfFrequency.QuadPart);
+                printf("%s scale (%s, %d passes, %d rows mirrored) took %dms\n", pagedIn ? "Paging in" : "Calculating",
+                    precisionNames[precision], passes, mirrorEnd - mirrorStart, (int)ms);
+            }
+            if (!pagedIn) {
+                int xStep, yStep;
+                progressiveGrid(passes, &xStep, &yStep);
+                recordStep(control, interaction, ms, pixels, fraction, 1.0 / (xStep * yStep), firstPassIters);
             }
 
             // Set finalized parameters
-            swapBuffer.freshlyCalculated = true;
-            swapBuffer.params = target;
-            swapBuffer.missingB = swapBuffer.missingT = swapBuffer.missingL = swapBuffer.missingR = 0;
-            memset((bool*)swapBuffer.stripeProgress, false, sizeof(swapBuffer.stripeProgress));
-            swapBuffer.stripeProgress[0][0] = true;
+            renderer->swapBuffer.freshlyCalculated = true;
+            renderer->swapBuffer.params = target;
+            renderer->swapBuffer.precision = precision;
+            renderer->swapBuffer.mirrorStart = mirrorStart; renderer->swapBuffer.mirrorEnd = mirrorEnd;
+            renderer->swapBuffer.missingB = renderer->swapBuffer.missingT = renderer->swapBuffer.missingL = renderer->swapBuffer.missingR = 0;
+            // Paged in view is complete, nothing left to refine
+            renderer->swapBuffer.passesDone = passes;
+            renderer->swapBuffer.phaseX = renderer->swapBuffer.phaseY = 0;
+            renderer->swapBuffer.firstPassIters = firstPassIters;
             MemoryBarrier();
-            swapBuffer.wip = 0;
+            renderer->swapBuffer.wip = 0;
             if (DEBUG_THREAD >= 2) printf("Done!!\n");
         }
-        else if (!striping_done(mainBuffer.stripeProgress)) {
-            DesiredParams target = mainBuffer.params;
-            int missingL = mainBuffer.missingL, missingR = mainBuffer.missingR,
-                missingT = mainBuffer.missingT, missingB = mainBuffer.missingB;
+        // Pan thread resizes renderer->mainBuffer first
+        else if (target.width != renderer->mainBuffer.params.width || target.height != renderer->mainBuffer.params.height) {
+            releaseBufferSemaphore(renderer, 'C');
+        }
+        else if (!progressive_done(renderer->mainBuffer)) {
+            DesiredParams target = renderer->mainBuffer.params;
+            int missingL = renderer->mainBuffer.missingL, missingR = renderer->mainBuffer.missingR,
+                missingT = renderer->mainBuffer.missingT, missingB = renderer->mainBuffer.missingB;
             // There is no partial area left, which makes it technically complete
             if (missingL + missingR >= target.width || missingT + missingB >= target.height) {
-                memset((bool*)swapBuffer.stripeProgress, true, sizeof(swapBuffer.stripeProgress));
-                releaseBufferSemaphore('C');
+                renderer->mainBuffer.passesDone = PROGRESSIVE_PASSES;
+                releaseBufferSemaphore(renderer, 'C');
                 continue;
             }
 
-            lastTouchedTag = mainBuffer.tag;
-            if (!swapBuffer.array || swapBuffer.params.width != mainBuffer.params.width || swapBuffer.params.height != mainBuffer.params.height) {
-                reallocSwapBuffer(mainBuffer.params.width, mainBuffer.params.height);
-            }
-            memcpy(swapBuffer.array, mainBuffer.array, mainBuffer.params.width * mainBuffer.params.height * sizeof(fracInt));
+            lastTouchedTag = renderer->mainBuffer.tag;
+            reserveBuffer(&renderer->swapBuffer, renderer->mainBuffer.params.width, renderer->mainBuffer.params.height);
+            memcpy(renderer->swapBuffer.array, renderer->mainBuffer.array, renderer->mainBuffer.params.width * renderer->mainBuffer.params.height * sizeof(fracInt));
 
-            // Get relevant data from mainBuffer
-            fracInt *swapArray = swapBuffer.array;
-            int rowMicros = mainBuffer.rowMicros;
-            bool stripeProgress[STRIPING][STRIPING];
-            memcpy(stripeProgress, (bool*)mainBuffer.stripeProgress, sizeof(stripeProgress));
+            // Get relevant data from renderer->mainBuffer
+            fracInt *swapArray = renderer->swapBuffer.array;
+            int firstPassIters = renderer->mainBuffer.firstPassIters;
+            Precision precision = renderer->mainBuffer.precision;
+            int oldMirrorStart = renderer->mainBuffer.mirrorStart, oldMirrorEnd = renderer->mainBuffer.mirrorEnd;
+            int passesDone = renderer->mainBuffer.passesDone;
+            int phaseX = renderer->mainBuffer.phaseX, phaseY = renderer->mainBuffer.phaseY;
 
             MemoryBarrier();
-            swapBuffer.wip = 1;
-            releaseBufferSemaphore('C');
+            renderer->swapBuffer.wip = 1;
+            releaseBufferSemaphore(renderer, 'C');
             
-            if (DEBUG_STRIPING) printf("Calculating scale striping progress!!\n");
+            if (DEBUG_STRIPING) printf("Calculating progressive pass!!\n");
 
-            // Schedule task regions
-            if (WaitForSingleObject(taskSemaphore, INFINITE) != 0) {
-                fprintf(stderr, "Calculate thread could not acquire task semaphore\n");
-                continue;
-            }
-
-            // Find the correct stripes to do next
-            if (DEBUG_STRIPING >= 2) printf("Progress before calculation: {%c%c%c}{%c%c%c}{%c%c%c}\n",
-                stripeProgress[0][0]?'-':' ', stripeProgress[0][1]?'-':' ', stripeProgress[0][2]?'-':' ',
-                stripeProgress[1][0]?'-':' ', stripeProgress[1][1]?'-':' ', stripeProgress[1][2]?'-':' ',
-                stripeProgress[2][0]?'-':' ', stripeProgress[2][1]?'-':' ', stripeProgress[2][2]?'-':' ');
-            size_t finishedRowCount = 0;
-            size_t rowStarted = 100;
-            size_t rowNotStarted = 100;
-            for (size_t row = 0; row < STRIPING; row++) {
-                if (striping_row_done(stripeProgress, row))
-                    finishedRowCount++;
-                else if (striping_row_started(stripeProgress, row))
-                    rowStarted = row;
-                else
-                    rowNotStarted = row;
-            }
-
-            size_t vstripe = 0;
-            size_t hstriping = 0;
-            size_t hstripe = 0;
-            bool hfillIn = false;
-            // Unfinished row, do its last unfinished column
-            if (rowStarted != 100) {
-                vstripe = rowStarted;
-                hstriping = STRIPING;
-                for (size_t col = 0; col < STRIPING; col++) {
-                    if (!stripeProgress[rowStarted][col])
-                        hstripe = col;
-                }
-                stripeProgress[rowStarted][hstripe] = true;
-            }
-            // Start/do last unstarted row
-            else {
-                vstripe = rowNotStarted;
-                if (finishedRowCount == 0 || rowMicros >= 80 * 1000) {
-                    hstriping = STRIPING;
-                    hfillIn = true;
-                    stripeProgress[vstripe][0] = true;
-                } else {
-                    for (size_t col = 0; col < STRIPING; col++)
-                        stripeProgress[vstripe][col] = true;
-                }
+            int height = target.height - missingB - missingT;
+            int width = target.width - missingL - missingR;
+            // Take further passes along while they are predicted to fit the deadline
+            int passes = 1;
+            double pixels = passPixels(passesDone, width * height);
+            while (passesDone + passes < PROGRESSIVE_PASSES) {
+                double morePixels = pixels + passPixels(passesDone + passes, width * height);
+                if (morePixels * control->pixelNanos > deadlineNanos) break;
+                pixels = morePixels;
+                passes++;
             }
             
-            // memset(stripeProgress, true, sizeof(stripeProgress));
-
-            int height = target.height - missingB - missingT;
-            tasksTotal = min(MAX_QUEUE, height * 3);
+            int tasksTotal = min(tuning.maxTasks, height * 3);
             int padding = missingT;
-            tasksLeft = 0;
-            for (int y = 0; y < tasksTotal; y++) {
-                int top = padding + (int)round((double)height / tasksTotal * y);
-                int bottom = padding + (int)round((double)height / tasksTotal * (y + 1));
-                taskQueue[tasksLeft] = (WorkerTask){false, swapArray, maxIters,
-                    target.offsetX, target.offsetY, target.pixelStep, target.width, target.height,
-                    hstriping, hstripe, hfillIn, STRIPING, vstripe, false,
-                    top, bottom, missingL, target.width - missingR, false, 0, 0};
-                tasksLeft++;
+            int mirrorStart, mirrorEnd, mirrorSum;
+            findMirrorRows(target, padding, padding + height, &mirrorStart, &mirrorEnd, &mirrorSum);
+            // Rows copied earlier whose mirror has since been panned away follow no passes, redo them whole
+            WorkerTask fullRows = (WorkerTask){target.formula->calculate[precision], swapArray, maxIters,
+                target.formula->paramR, target.formula->paramI,
+                target.offsetX, target.offsetY, target.pixelStep, target.width, target.height,
+                0, 0, false, 0, 0, false,
+                0, 0, missingL, target.width - missingR, false, 0, 0};
+            int staleTop = max(padding, oldMirrorStart), staleBottom = min(padding + height, oldMirrorEnd);
+            queueRowTasks(queue, fullRows, staleTop, staleBottom, workerThreadCount, mirrorStart, mirrorEnd);
+            // The passes calculate disjoint pixels, so they run at once
+            for (int pass = passesDone; pass < passesDone + passes; pass++) {
+                WorkerTask task = fullRows;
+                setPassStriping(&task, pass, phaseX, phaseY);
+                queueRowTasks(queue, task, padding, padding + height,
+                    (tasksTotal - queue->total) / (passesDone + passes - pass), mirrorStart, mirrorEnd);
             }
 
-            if (DEBUG_STRIPING >= 2) printf("Calculating for yoff=%d; xoff=%d/%d fill:%c\n",
-                vstripe, hstripe, hstriping, hfillIn ? 'Y' : 'N');
+            if (DEBUG_STRIPING >= 2) printf("Calculating passes %d to %d of %d\n",
+                passesDone + 1, passesDone + passes, PROGRESSIVE_PASSES);
             QueryPerformanceCounter(&perfStart);
-            ReleaseSemaphore(taskSemaphore, 1, NULL);
-
-            while (tasksLeft >= 1) {
-                Sleep(3);
-            }
+            runTasks(queue);
             
+            passesDone += passes;
+            upsamplePasses(queue, swapArray, target, passesDone, phaseX, phaseY,
+                padding, padding + height, missingL, target.width - missingR, mirrorStart, mirrorEnd, mirrorSum);
+            copyMirrorRows(swapArray, target.width, mirrorStart, mirrorEnd, mirrorSum);
             QueryPerformanceCounter(&perfEnd);
-            if (finishedRowCount == 0)
-                swapBuffer.rowMicros += (perfEnd.QuadPart * 1000000 - perfStart.QuadPart * 1000000) / perfFrequency.QuadPart;
+            double ms = (double)(perfEnd.QuadPart - perfStart.QuadPart) * 1000 / perfFrequency.QuadPart;
             if (DEBUG_TIME) {
-                printf("Calculating scale striping progress took %dms\n", (perfEnd.QuadPart * 1000 - perfStart.QuadPart * 1000) / perfFrequency.QuadPart);
+                printf("Calculating %d progressive passes (%d rows mirrored) took %dms\n", passes, mirrorEnd - mirrorStart, (int)ms);
             }
+            int xStep, yStep;
+            progressiveGrid(passesDone, &xStep, &yStep);
+            recordStep(control, interaction, ms, pixels, 1, 1.0 / (xStep * yStep), firstPassIters);
 
             // Set finalized parameters
-            swapBuffer.freshlyCalculated = true;
-            swapBuffer.params = target;
-            swapBuffer.missingB = missingB; swapBuffer.missingT = missingT;
-            swapBuffer.missingL = missingL; swapBuffer.missingR = missingR;
-            memcpy((bool*)swapBuffer.stripeProgress, stripeProgress, sizeof(stripeProgress));
+            renderer->swapBuffer.freshlyCalculated = true;
+            renderer->swapBuffer.params = target;
+            renderer->swapBuffer.missingB = missingB; renderer->swapBuffer.missingT = missingT;
+            renderer->swapBuffer.missingL = missingL; renderer->swapBuffer.missingR = missingR;
+            renderer->swapBuffer.precision = precision;
+            renderer->swapBuffer.mirrorStart = mirrorStart; renderer->swapBuffer.mirrorEnd = mirrorEnd;
+            renderer->swapBuffer.passesDone = passesDone;
+            renderer->swapBuffer.phaseX = phaseX; renderer->swapBuffer.phaseY = phaseY;
+            renderer->swapBuffer.firstPassIters = firstPassIters;
             MemoryBarrier();
-            swapBuffer.wip = 0;
+            renderer->swapBuffer.wip = 0;
             if (DEBUG_STRIPING) printf("Done!!\n");
         }
-        else if (mainBuffer.missingL || mainBuffer.missingR || mainBuffer.missingT || mainBuffer.missingB) {
-            if (!swapBuffer.array || swapBuffer.params.width != mainBuffer.params.width || swapBuffer.params.height != mainBuffer.params.height) {
-                reallocSwapBuffer(mainBuffer.params.width, mainBuffer.params.height);
-            }
-            memcpy(swapBuffer.array, mainBuffer.array, mainBuffer.params.width * mainBuffer.params.height * sizeof(fracInt));
-
-            // Get relevant data from mainBuffer
-            fracInt *swapArray = swapBuffer.array;
-            DesiredParams target = mainBuffer.params;
-            int missingL = mainBuffer.missingL, missingR = mainBuffer.missingR,
-                missingT = mainBuffer.missingT, missingB = mainBuffer.missingB;
+        else if (renderer->mainBuffer.missingL || renderer->mainBuffer.missingR || renderer->mainBuffer.missingT || renderer->mainBuffer.missingB) {
+            reserveBuffer(&renderer->swapBuffer, renderer->mainBuffer.params.width, renderer->mainBuffer.params.height);
+            memcpy(renderer->swapBuffer.array, renderer->mainBuffer.array, renderer->mainBuffer.params.width * renderer->mainBuffer.params.height * sizeof(fracInt));
+
+            // Get relevant data from renderer->mainBuffer
+            fracInt *swapArray = renderer->swapBuffer.array;
+            DesiredParams target = renderer->mainBuffer.params;
+            Precision precision = renderer->mainBuffer.precision;
+            int missingL = renderer->mainBuffer.missingL, missingR = renderer->mainBuffer.missingR,
+                missingT = renderer->mainBuffer.missingT, missingB = renderer->mainBuffer.missingB;
             if (missingL + missingR >= target.width || missingT + missingB >= target.height) {
                 missingL = target.width;
                 missingR = missingT = missingB = 0;
             }
-            swapBuffer.wip = 1;
-            releaseBufferSemaphore('C');
+            int firstPassIters = renderer->mainBuffer.firstPassIters;
+            int phaseX = renderer->mainBuffer.phaseX, phaseY = renderer->mainBuffer.phaseY;
+            renderer->swapBuffer.wip = 1;
+            releaseBufferSemaphore(renderer, 'C');
             
             if (DEBUG_THREAD >= 2) printf("Calculating move!!\n");
 
-            // Schedule task regions
-            if (WaitForSingleObject(taskSemaphore, INFINITE) != 0) {
-                fprintf(stderr, "Calculate thread could not acquire task semaphore\n");
-                continue;
-            }
+            // Idle workers may have rendered some of it already
+            fillFromPrefetch(&renderer->prefetch, swapArray, target, precision, &missingL, &missingR, &missingT, &missingB);
 
             int newArea = target.width * target.height
                 - (target.width - missingL - missingR) * (target.height - missingT - missingB);
-            tasksTotal = max(3, min(MAX_QUEUE, max(workerThreadCount, newArea / 10000)));
-            tasksLeft = 0;
+            // Only the part of the new area next to the content that fits the deadline, the outer part stays missing
+            double share = newArea ? min(1, deadlineNanos / (newArea * control->pixelNanos)) : 1;
+            int keepL = (int)(missingL * (1 - share)), keepR = (int)(missingR * (1 - share)),
+                keepT = (int)(missingT * (1 - share)), keepB = (int)(missingB * (1 - share));
+            int renderWidth = target.width - keepL - keepR;
+            int renderT = missingT - keepT, renderB = missingB - keepB;
+            int renderArea = renderWidth * (target.height - keepT - keepB)
+                - (target.width - missingL - missingR) * (target.height - missingT - missingB);
+            int tasksTotal = max(3, min(tuning.maxTasks, max(workerThreadCount, renderArea / tuning.panTaskPixels)));
 
             int fullWidthTasks = 0;
-            if (missingT || missingB) {
+            if (renderT || renderB) {
                 // Use tasks out of the total pool based on proportional share of area
-                int fullWidthArea = target.width * (missingT + missingB);
-                fullWidthTasks = max(2, min(tasksTotal - 1, tasksTotal * fullWidthArea / newArea));
-                if (!missingL && !missingR) {
+                int fullWidthArea = renderWidth * (renderT + renderB);
+                fullWidthTasks = max(2, min(tasksTotal - 1, tasksTotal * fullWidthArea / renderArea));
+                if (missingL == keepL && missingR == keepR) {
                     fullWidthTasks = tasksTotal;
                 }
-                int topTasks = !missingT ? 0
-                             : !missingB ? fullWidthTasks
-                             : min(fullWidthTasks - 1, (1, (fullWidthTasks * missingT * target.width / fullWidthArea)));
+                int topTasks = !renderT ? 0
+                             : !renderB ? fullWidthTasks
+                             : min(fullWidthTasks - 1, max(1, (fullWidthTasks * renderT * renderWidth / fullWidthArea)));
                 int bottomTasks = fullWidthTasks - topTasks;
 
                 for (int y = 0; y < topTasks; y++) {
-                    int top = (int)round((double)missingT / topTasks * y);
-                    int bottom = (int)round((double)missingT / topTasks * (y + 1));
+                    int top = keepT + (int)round((double)renderT / topTasks * y);
+                    int bottom = keepT + (int)round((double)renderT / topTasks * (y + 1));
                     if (bottom - top == 0) continue;
-                    taskQueue[tasksLeft] = (WorkerTask){false, swapArray, maxIters,
+                    queueTask(queue, (WorkerTask){target.formula->calculate[precision], swapArray, maxIters,
+                        target.formula->paramR, target.formula->paramI,
                         target.offsetX, target.offsetY, target.pixelStep, target.width, target.height,
                         0, 0, false, 0, 0, false,
-                        top, bottom, 0, target.width, false, 0, 0};
-                    tasksLeft++;
+                        top, bottom, keepL, target.width - keepR, false, 0, 0});
                 }
                 int paddingB = target.height - missingB;
                 for (int y = 0; y < bottomTasks; y++) {
-                    int top = paddingB + (int)round((double)missingB / bottomTasks * y);
-                    int bottom = paddingB + (int)round((double)missingB / bottomTasks * (y + 1));
+                    int top = paddingB + (int)round((double)renderB / bottomTasks * y);
+                    int bottom = paddingB + (int)round((double)renderB / bottomTasks * (y + 1));
                     if (bottom - top == 0) continue;
-                    taskQueue[tasksLeft] = (WorkerTask){false, swapArray, maxIters,
+                    queueTask(queue, (WorkerTask){target.formula->calculate[precision], swapArray, maxIters,
+                        target.formula->paramR, target.formula->paramI,
                         target.offsetX, target.offsetY, target.pixelStep, target.width, target.height,
                         0, 0, false, 0, 0, false,
-                        top, bottom, 0, target.width, false, 0, 0};
-                    tasksLeft++;
+                        top, bottom, keepL, target.width - keepR, false, 0, 0});
                 }
             }
 
-            if (missingL || missingR) {
+            if (missingL > keepL || missingR > keepR) {
                 int sideTasks = tasksTotal - fullWidthTasks;
                 int r1xStart, r1xEnd, r2xStart = 0, r2xEnd = 0;
                 bool region2 = false;
-                if (missingL && missingR) {
-                    r1xStart = 0;
+                if (missingL > keepL && missingR > keepR) {
+                    r1xStart = keepL;
                     r1xEnd = missingL;
                     region2 = true;
                     r2xStart = target.width - missingR;
-                    r2xEnd = target.width;
-                } else if (missingL) {
-                    r1xStart = 0;
+                    r2xEnd = target.width - keepR;
+                } else if (missingL > keepL) {
+                    r1xStart = keepL;
                     r1xEnd = missingL;
                 } else {
                     r1xStart = target.width - missingR;
-                    r1xEnd = target.width;
+                    r1xEnd = target.width - keepR;
                 }
                 int height = target.height - missingB - missingT;
                 int padding = missingT;
@@ -610,50 +1465,324 @@ unsigned __stdcall CalculateThreadFunction( void* pArguments ) {
                     int top = padding + (int)round((double)height / sideTasks * y);
                     int bottom = padding + (int)round((double)height / sideTasks * (y + 1));
                     if (bottom - top == 0) continue;
-                    taskQueue[tasksLeft] = (WorkerTask){false, swapArray, maxIters,
+                    queueTask(queue, (WorkerTask){target.formula->calculate[precision], swapArray, maxIters,
+                        target.formula->paramR, target.formula->paramI,
                         target.offsetX, target.offsetY, target.pixelStep, target.width, target.height,
                         0, 0, false, 0, 0, false,
-                        top, bottom, r1xStart, r1xEnd, region2, r2xStart, r2xEnd};
-                    tasksLeft++;
+                        top, bottom, r1xStart, r1xEnd, region2, r2xStart, r2xEnd});
                 }
             }
             
-            tasksTotal = tasksLeft;
             
-            if (DEBUG_TIME) {
-                QueryPerformanceCounter(&perfStart);
-            }
-            ReleaseSemaphore(taskSemaphore, 1, NULL);
-
-            while (tasksLeft > 0) {
-                Sleep(3);
-            }
+            QueryPerformanceCounter(&perfStart);
+            runTasks(queue);
             
-            if (DEBUG_TIME) {
-                QueryPerformanceCounter(&perfEnd);
-                printf("Calculating move took %dms\n", (perfEnd.QuadPart * 1000 - perfStart.QuadPart * 1000) / perfFrequency.QuadPart);
-            }
+            QueryPerformanceCounter(&perfEnd);
+            double ms = (double)(perfEnd.QuadPart - perfStart.QuadPart) * 1000 / perfFrequency.QuadPart;
+            if (DEBUG_TIME) printf("Calculating move took %dms\n", (int)ms);
+            int stillMissing = target.width * target.height - (target.width - keepL - keepR) * (target.height - keepT - keepB);
+            recordStep(control, interaction, ms, renderArea, 1, 1 - (double)stillMissing / (target.width * target.height), maxIters);
 
             // Set finalized parameters
-            swapBuffer.freshlyCalculated = true;
-            swapBuffer.params = target;
-            swapBuffer.missingB = swapBuffer.missingT = swapBuffer.missingL = swapBuffer.missingR = 0;
+            renderer->swapBuffer.freshlyCalculated = true;
+            renderer->swapBuffer.params = target;
+            renderer->swapBuffer.precision = precision;
+            renderer->swapBuffer.mirrorStart = renderer->swapBuffer.mirrorEnd = 0;
+            renderer->swapBuffer.missingL = keepL; renderer->swapBuffer.missingR = keepR;
+            renderer->swapBuffer.missingT = keepT; renderer->swapBuffer.missingB = keepB;
+            renderer->swapBuffer.passesDone = PROGRESSIVE_PASSES;
+            renderer->swapBuffer.firstPassIters = firstPassIters;
+            renderer->swapBuffer.phaseX = phaseX; renderer->swapBuffer.phaseY = phaseY;
             MemoryBarrier();
-            swapBuffer.wip = 0;
+            renderer->swapBuffer.wip = 0;
             if (DEBUG_THREAD >= 2) printf("Done!!\n");
         }
+        // First pass was capped during interaction, finish its pixels once idle
+        else if (renderer->mainBuffer.firstPassIters < maxIters && interaction == INTERACTION_NONE) {
+            lastTouchedTag = renderer->mainBuffer.tag;
+            reserveBuffer(&renderer->swapBuffer, renderer->mainBuffer.params.width, renderer->mainBuffer.params.height);
+            memcpy(renderer->swapBuffer.array, renderer->mainBuffer.array, renderer->mainBuffer.params.width * renderer->mainBuffer.params.height * sizeof(fracInt));
+
+            // Get relevant data from renderer->mainBuffer
+            fracInt *swapArray = renderer->swapBuffer.array;
+            DesiredParams target = renderer->mainBuffer.params;
+            Precision precision = renderer->mainBuffer.precision;
+            int phaseX = renderer->mainBuffer.phaseX, phaseY = renderer->mainBuffer.phaseY;
+            MemoryBarrier();
+            renderer->swapBuffer.wip = 1;
+            releaseBufferSemaphore(renderer, 'C');
+
+            int mirrorStart, mirrorEnd, mirrorSum;
+            findMirrorRows(target, 0, target.height, &mirrorStart, &mirrorEnd, &mirrorSum);
+            WorkerTask task = (WorkerTask){target.formula->calculate[precision], swapArray, maxIters,
+                target.formula->paramR, target.formula->paramI,
+                target.offsetX, target.offsetY, target.pixelStep, target.width, target.height,
+                0, 0, false, 0, 0, false,
+                0, 0, 0, target.width, false, 0, 0};
+            setPassStriping(&task, 0, phaseX, phaseY);
+            queueRowTasks(queue, task, 0, target.height, min(tuning.maxTasks, target.height * 3), mirrorStart, mirrorEnd);
+            QueryPerformanceCounter(&perfStart);
+            runTasks(queue);
+            copyMirrorRows(swapArray, target.width, mirrorStart, mirrorEnd, mirrorSum);
+            QueryPerformanceCounter(&perfEnd);
+            double ms = (double)(perfEnd.QuadPart - perfStart.QuadPart) * 1000 / perfFrequency.QuadPart;
+            if (DEBUG_TIME) printf("Calculating uncapped first pass took %dms\n", (int)ms);
+            recordStep(control, interaction, ms, passPixels(0, target.width * target.height), 1, 1, maxIters);
+
+            // Set finalized parameters
+            renderer->swapBuffer.freshlyCalculated = true;
+            renderer->swapBuffer.params = target;
+            renderer->swapBuffer.precision = precision;
+            renderer->swapBuffer.mirrorStart = renderer->swapBuffer.mirrorEnd = 0;
+            renderer->swapBuffer.missingB = renderer->swapBuffer.missingT = renderer->swapBuffer.missingL = renderer->swapBuffer.missingR = 0;
+            renderer->swapBuffer.passesDone = PROGRESSIVE_PASSES;
+            renderer->swapBuffer.phaseX = phaseX; renderer->swapBuffer.phaseY = phaseY;
+            renderer->swapBuffer.firstPassIters = maxIters;
+            MemoryBarrier();
+            renderer->swapBuffer.wip = 0;
+        }
+        // Nothing left to calculate, idle workers render the border around the view
         else {
-            releaseBufferSemaphore('C');
+            Prefetch *prefetch = &renderer->prefetch;
+            QueryPerformanceCounter(&perfEnd);
+            if (prefetch->idleTag == renderer->mainBuffer.tag) prefetch->idleTicks += perfEnd.QuadPart - prefetch->idleTime.QuadPart;
+            prefetch->idleTag = renderer->mainBuffer.tag;
+            prefetch->idleTime = perfEnd;
+            if (prefetch->running && prefetch->queue.left == 0) finishPrefetch(prefetch);
+
+            DesiredParams view = renderer->mainBuffer.params;
+            bool current = prefetchMatches(prefetch, view, renderer->mainBuffer.precision)
+                && prefetch->view.offsetX == view.offsetX && prefetch->view.offsetY == view.offsetY
+                && prefetch->view.width == view.width && prefetch->view.height == view.height;
+            if (!current && renderer->mainBuffer.firstPassIters == maxIters) {
+                // Start over around the new view once the workers are done with the old one
+                if (prefetch->running) prefetch->queue.cancelled = true;
+                else startPrefetch(renderer);
+            }
+            releaseBufferSemaphore(renderer, 'C');
         }
     }
     if (DEBUG_THREAD) printf("Finishing CalculateThreadFunction\n");
     return 0;
 }
 
+uint32_t paletteColor(int value) {
+    return (uint32_t)(uint8_t)palette[value * 4] << 16
+        | (uint32_t)(uint8_t)palette[value * 4 + 1] << 8
+        | (uint8_t)palette[value * 4 + 2];
+}
+
+/** Only use with buffer semaphore, copies renderer->mainBuffer into the next slot of the frame ring */
+void exportFrame(Renderer *renderer) {
+    volatile BufferArray *buffer = &renderer->mainBuffer;
+    int width = buffer->params.width, height = buffer->params.height;
+    FrameSlotHeader *slot = frameRingBegin(renderer->frameRing, width, height);
+    if (!slot) {
+        if (DEBUG_EXPORT) printf("Frame %dx%d does not fit the frame ring\n", width, height);
+        return;
+    }
+    slot->flags = progressive_done(*buffer)
+        && !buffer->missingL && !buffer->missingR && !buffer->missingT && !buffer->missingB ? FRAME_SLOT_COMPLETE : 0;
+    slot->formula = buffer->params.formula ? buffer->params.formula - formulas : 0;
+    slot->maxIters = maxIters;
+    slot->passesDone = buffer->passesDone;
+    slot->centerX = buffer->params.offsetX;
+    slot->centerY = buffer->params.offsetY;
+    slot->pixelStep = buffer->params.pixelStep;
+
+    const FrameRingHeader *header = frameRingHeader(renderer->frameRing);
+    if (header->flags & FRAME_RING_ITERS)
+        memcpy(frameSlotIters(slot), buffer->array, width * height * sizeof(fracInt));
+    if (header->flags & FRAME_RING_BGRA) {
+        uint32_t *pixels = frameSlotPixels(header, slot);
+        for (int i = 0; i < width * height; i++)
+            pixels[i] = 0xff000000 | paletteColor(buffer->array[i]);
+    }
+    frameRingPublish(renderer->frameRing, slot);
+}
+
+/** Replaces listed pixel colors by the average color of a samples x samples grid inside the pixel */
+void supersample(const WorkerTask *task) {
+    int samples = task->samples;
+    fracInt grid[AA_MAX_SAMPLES * AA_MAX_SAMPLES];
+    double sampleStep = task->pixelStep / samples;
+    // calculate() centers the grid on sample floor(samples / 2), even grids need half a sample more
+    double shift = samples % 2 ? 0 : sampleStep / 2;
+    int left = -(int)floor((float)task->width / 2);
+    int top = -(int)floor((float)task->height / 2);
+    int count = samples * samples;
+
+    for (int i = task->listStart; i < task->listEnd; i++) {
+        int index = task->pixelList[i];
+        int px = index % task->width, py = index / task->width;
+        double x = task->centerX + task->pixelStep * (left + px) + shift;
+        double y = task->centerY + task->pixelStep * (top + py) + shift;
+        task->calculate(grid, task->maxIters, task->paramR, task->paramI,
+            x, y, sampleStep, samples, samples,
+            0, 0, false, 0, 0, false,
+            0, samples, 0, samples, false, 0, 0);
+
+        int r = 0, g = 0, b = 0;
+        for (int sample = 0; sample < count; sample++) {
+            uint32_t color = paletteColor(grid[sample]);
+            r += color >> 16 & 0xFF;
+            g += color >> 8 & 0xFF;
+            b += color & 0xFF;
+        }
+        task->colors[index] = (uint32_t)((r + count / 2) / count) << 16
+            | (uint32_t)((g + count / 2) / count) << 8
+            | (uint32_t)((b + count / 2) / count);
+    }
+}
+
+/** Hash of the sample index, so that sample n is the same c however the samples are split */
+uint64_t splitMix(uint64_t value) {
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ value >> 30) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ value >> 27) * 0x94D049BB133111EBull;
+    return value ^ value >> 31;
+}
+
+/** Main cardioid or period 2 bulb, orbits of these never escape */
+bool inMainBulbs(double x, double y) {
+    double q = (x - 0.25) * (x - 0.25) + y * y;
+    return q * (q + (x - 0.25)) <= 0.25 * y * y || (x + 1) * (x + 1) + y * y <= 0.0625;
+}
+
+/** Iterates the task's samples and records the orbits that count into the worker's own histogram */
+void sampleDensity(const WorkerTask *task, unsigned int workerId) {
+    const DensityRender *density = task->density;
+    uint32_t *histogram = task->histograms[workerId];
+    DensityCounts counts = { 0 };
+    // Orbit is kept until it is known whether it counts
+    double *orbit = malloc(density->maxIters * 2 * sizeof(double));
+    double scale = 1 / density->pixelStep;
+    double originX = density->width / 2 + 0.5 - density->centerX * scale;
+    double originY = density->height / 2 + 0.5 - density->centerY * scale;
+    for (uint64_t sample = task->sampleStart; sample < task->sampleEnd; sample++) {
+        uint64_t hash = splitMix(sample);
+        double x = DENSITY_SAMPLE_RADIUS * ((hash >> 11) * 0x1p-52 - 1);
+        double y = DENSITY_SAMPLE_RADIUS * ((splitMix(hash) >> 11) * 0x1p-52 - 1);
+        if (!density->anti && inMainBulbs(x, y)) {
+            counts.skipped++;
+            continue;
+        }
+        double cr = 0, ci = 0;
+        int iters = 0;
+        while (iters < density->maxIters && cr * cr + ci * ci <= 4) {
+            double newCr = cr * cr - ci * ci + x;
+            ci = 2 * cr * ci + y;
+            cr = newCr;
+            orbit[iters * 2] = cr;
+            orbit[iters * 2 + 1] = ci;
+            iters++;
+        }
+        bool escaped = cr * cr + ci * ci > 4;
+        if (density->anti ? escaped : !escaped || iters < density->minIters) continue;
+        counts.recorded++;
+        for (int i = 0; i < iters; i++) {
+            int px = (int)floor(orbit[i * 2] * scale + originX);
+            int py = (int)floor(orbit[i * 2 + 1] * scale + originY);
+            if (px >= 0 && px < density->width && py >= 0 && py < density->height)
+                histogram[py * density->width + px]++;
+        }
+    }
+    free(orbit);
+    task->counts[workerId].skipped += counts.skipped;
+    task->counts[workerId].recorded += counts.recorded;
+}
+
+/** Adds rows of every worker's histogram to the total, the histograms are freed afterwards */
+void mergeDensity(const WorkerTask *task) {
+    DensityRender *density = task->density;
+    size_t start = (size_t)task->yStart * density->width, end = (size_t)task->yEnd * density->width;
+    for (unsigned int worker = 0; worker < workerThreadCount; worker++) {
+        uint32_t *histogram = task->histograms[worker];
+        for (size_t i = start; i < end; i++)
+            density->histogram[i] += histogram[i];
+    }
+}
+
+/** Iterates the task's pixels or points further, collecting the ones still inside at maxIters in its list */
+void resumePixels(const WorkerTask *task) {
+    ResumableRender *render = task->resumable;
+    ResumeFunction resume = render->formula->resume;
+    ResumeList *list = task->resumeList;
+    if (task->fromIters > 0) {
+        // Compacted within the task's range, the render moves the ranges together afterwards
+        list->count = resume(render->points + task->listStart, task->listEnd - task->listStart, render->iterations,
+            task->fromIters, task->maxIters, render->formula->paramR, render->formula->paramI,
+            render->centerX, render->centerY, render->pixelStep, render->width, render->height);
+        return;
+    }
+    ResumePoint chunk[RESUME_CHUNK];
+    for (int start = task->listStart; start < task->listEnd; start += RESUME_CHUNK) {
+        int count = min(RESUME_CHUNK, task->listEnd - start);
+        for (int i = 0; i < count; i++)
+            chunk[i] = (ResumePoint){ start + i, 0, 0 };
+        int inside = resume(chunk, count, render->iterations, 0, task->maxIters,
+            render->formula->paramR, render->formula->paramI,
+            render->centerX, render->centerY, render->pixelStep, render->width, render->height);
+        if (list->count + inside > list->capacity) {
+            list->capacity = max(list->capacity * 2, list->count + inside);
+            list->points = realloc(list->points, list->capacity * sizeof(ResumePoint));
+        }
+        memcpy(list->points + list->count, chunk, inside * sizeof(ResumePoint));
+        list->count += inside;
+    }
+}
+
+/** Fills the rectangle [x0, x1) x [y0, y1) from a proof, or splits it and calculates the smallest parts that fail */
+void certifyOrSplit(const WorkerTask *task, CertifyCounts *counts, int x0, int y0, int x1, int y1) {
+    // Pixel coordinates exactly as calculate() computes them
+    int left = -(int)floor((float)task->width / 2);
+    int top = -(int)floor((float)task->height / 2);
+    counts->tried++;
+    int iters = certifyTile(task->formula, task->maxIters,
+        task->centerX + task->pixelStep * (left + x0), task->centerX + task->pixelStep * (left + x1 - 1),
+        task->centerY + task->pixelStep * (top + y0), task->centerY + task->pixelStep * (top + y1 - 1));
+    if (iters >= 0) {
+        counts->proven++;
+        counts->certified += (x1 - x0) * (y1 - y0);
+        for (int py = y0; py < y1; py++) {
+            for (int px = x0; px < x1; px++)
+                task->target[py * task->width + px] = iters;
+        }
+        return;
+    }
+    if (x1 - x0 > CERTIFY_MIN_TILE || y1 - y0 > CERTIFY_MIN_TILE) {
+        int xm = x1 - x0 > CERTIFY_MIN_TILE ? (x0 + x1) / 2 : x1;
+        int ym = y1 - y0 > CERTIFY_MIN_TILE ? (y0 + y1) / 2 : y1;
+        certifyOrSplit(task, counts, x0, y0, xm, ym);
+        if (xm < x1) certifyOrSplit(task, counts, xm, y0, x1, ym);
+        if (ym < y1) certifyOrSplit(task, counts, x0, ym, xm, y1);
+        if (xm < x1 && ym < y1) certifyOrSplit(task, counts, xm, ym, x1, y1);
+        return;
+    }
+    task->calculate(task->target, task->maxIters, task->paramR, task->paramI,
+        task->centerX, task->centerY, task->pixelStep, task->width, task->height,
+        0, 0, false, 0, 0, false,
+        y0, y1, x0, x1, false, 0, 0);
+}
+
+/** TASK_CERTIFY: every tile of the task's rows */
+void certifyRows(const WorkerTask *task, unsigned int workerId) {
+    CertifyCounts counts = { 0 };
+    for (int y = task->yStart; y < task->yEnd; y += CERTIFY_TILE) {
+        for (int x = 0; x < task->width; x += CERTIFY_TILE)
+            certifyOrSplit(task, &counts, x, y, min(x + CERTIFY_TILE, task->width), min(y + CERTIFY_TILE, task->yEnd));
+    }
+    task->certifyCounts[workerId].certified += counts.certified;
+    task->certifyCounts[workerId].proven += counts.proven;
+    task->certifyCounts[workerId].tried += counts.tried;
+}
+
 unsigned __stdcall WorkerThreadFunction( void* pArguments ) {
     unsigned int workerId = (unsigned int)(uintptr_t)pArguments;
     int currentTaskI = -1;
+    TaskQueue *currentQueue = 0;
     WorkerTask currentTask = { 0 };
+    LARGE_INTEGER taskStart, taskEnd;
     while (threadsRunning) {
         // If thread was performing a task last loop, don't waste time with Sleep
         if (currentTaskI == -1)
@@ -661,15 +1790,30 @@ unsigned __stdcall WorkerThreadFunction( void* pArguments ) {
 
         currentTaskI = -1;
         // Find next task
-        if (tasksLeft <= 0) continue;
+        if (activeQueueCount <= 0) continue;
 
         if (WaitForSingleObject(taskSemaphore, 1000) != 0) continue;
-        for (size_t i = 0; i < tasksTotal; i++) {
-            if (!taskQueue[i].taken) {
-                taskQueue[i].taken = true;
-                currentTaskI = i;
-                currentTask = taskQueue[i];
-                break;
+        if (activeQueueCount > 0) {
+            // One task from each queue in turn, so a big render does not hold up the others,
+            // skipping queues of a lower priority than the highest one waiting
+            RenderPriority priority = RENDER_PRIORITY_BATCH;
+            for (int i = 0; i < activeQueueCount; i++)
+                priority = max(priority, activeQueues[i]->priority);
+            int queueI = nextActiveQueue % activeQueueCount;
+            while (activeQueues[queueI]->priority != priority)
+                queueI = (queueI + 1) % activeQueueCount;
+            currentQueue = activeQueues[queueI];
+            currentTaskI = currentQueue->next;
+            currentTask = currentQueue->tasks[currentTaskI];
+            currentQueue->next++;
+            if (currentQueue->next >= currentQueue->total) {
+                // Handed out completely, the queue after it moves into its place
+                activeQueueCount--;
+                memmove((TaskQueue**)activeQueues + queueI, (TaskQueue**)activeQueues + queueI + 1,
+                    (activeQueueCount - queueI) * sizeof(TaskQueue*));
+                nextActiveQueue = queueI;
+            } else {
+                nextActiveQueue = queueI + 1;
             }
         }
         ReleaseSemaphore(taskSemaphore, 1, NULL);
@@ -677,71 +1821,440 @@ unsigned __stdcall WorkerThreadFunction( void* pArguments ) {
 
         // Calculate
         if (DEBUG_WORKER) printf("Calculating thread %d task %d\n", workerId, currentTaskI);
-        calculate(currentTask.target, currentTask.maxIters,
-            currentTask.centerX, currentTask.centerY, currentTask.pixelStep, currentTask.width, currentTask.height,
-            currentTask.hstriping, currentTask.hstripeOffset, currentTask.hfillIn,
-            currentTask.vstriping, currentTask.vstripeOffset, currentTask.vfillIn,
-            currentTask.yStart, currentTask.yEnd,
-            currentTask.r1xStart, currentTask.r1xEnd,
-            currentTask.region2, currentTask.r2xStart, currentTask.r2xEnd);
+        QueryPerformanceCounter(&taskStart);
+        if (currentQueue->cancelled) {
+            // Counts as done without calculating it
+        } else if (currentTask.kind == TASK_SUPERSAMPLE) {
+            supersample(&currentTask);
+        } else if (currentTask.kind == TASK_UPSAMPLE) {
+            upsample(&currentTask);
+        } else if (currentTask.kind == TASK_DENSITY) {
+            sampleDensity(&currentTask, workerId);
+        } else if (currentTask.kind == TASK_DENSITY_MERGE) {
+            mergeDensity(&currentTask);
+        } else if (currentTask.kind == TASK_RESUME) {
+            resumePixels(&currentTask);
+        } else if (currentTask.kind == TASK_CERTIFY) {
+            certifyRows(&currentTask, workerId);
+        } else {
+            currentTask.calculate(currentTask.target, currentTask.maxIters,
+                currentTask.paramR, currentTask.paramI,
+                currentTask.centerX, currentTask.centerY, currentTask.pixelStep, currentTask.width, currentTask.height,
+                currentTask.hstriping, currentTask.hstripeOffset, currentTask.hfillIn,
+                currentTask.vstriping, currentTask.vstripeOffset, currentTask.vfillIn,
+                currentTask.yStart, currentTask.yEnd,
+                currentTask.r1xStart, currentTask.r1xEnd,
+                currentTask.region2, currentTask.r2xStart, currentTask.r2xEnd);
+        }
 
         // Announce task done
         if (WaitForSingleObject(taskSemaphore, INFINITE) != 0) continue;
         if (DEBUG_WORKER) printf("Finished thread %d!!\n", workerId);
-        tasksLeft--;
+        QueryPerformanceCounter(&taskEnd);
+        currentQueue->busyTicks += taskEnd.QuadPart - taskStart.QuadPart;
+        workerBusyTicks += taskEnd.QuadPart - taskStart.QuadPart;
+        currentQueue->left--;
         ReleaseSemaphore(taskSemaphore, 1, NULL);
     }
     if (DEBUG_THREAD) printf("Finishing WorkerThreadFunction %d\n", workerId);
     return 0;
 }
 
+int rendererOpenTiles(Renderer *renderer, const char *path) {
+    // Only the calculate thread reads it, before the first scale it does not look at it yet
+    renderer->tilePyramid = tilePyramidOpen(path);
+    return renderer->tilePyramid ? 0 : 1;
+}
+
+int rendererExportFrames(Renderer *renderer, const char *name, int maxWidth, int maxHeight, bool iters, bool bgra) {
+    // Only the pan thread reads it, it starts publishing with the next change of mainBuffer
+    renderer->frameRing = frameRingCreate(name, maxWidth, maxHeight,
+        (iters ? FRAME_RING_ITERS : 0) | (bgra ? FRAME_RING_BGRA : 0));
+    return renderer->frameRing ? 0 : 1;
+}
+
 // The rest is never gonna be called before successful rendererInitialize
-void panFrame(int xPixels, int yPixels) {
-    if (WaitForSingleObject(statusSemaphore, 100) != 0) return;
-    desiredOffsetX -= (double)xPixels * getCurrentPixelStep();
-    desiredOffsetY -= (double)yPixels * getCurrentPixelStep();
-    ReleaseSemaphore(statusSemaphore, 1, NULL);
+void renderBlocking(const Formula *formula, fracInt *target, double centerX, double centerY, double pixelStep, int width, int height) {
+    renderPrioritized(RENDER_PRIORITY_BATCH, formula, target, centerX, centerY, pixelStep, width, height);
+}
+
+void renderPrioritized(
+    RenderPriority priority, const Formula *formula, fracInt *target,
+    double centerX, double centerY, double pixelStep, int width, int height
+) {
+    TaskQueue *queue = calloc(1, sizeof(TaskQueue));
+    queue->priority = priority;
+    int tasksTotal = min(tuning.maxTasks, max(workerThreadCount, height / 8));
+    for (int y = 0; y < tasksTotal; y++) {
+        int top = (int)round((double)height / tasksTotal * y);
+        int bottom = (int)round((double)height / tasksTotal * (y + 1));
+        if (bottom - top == 0) continue;
+        queueTask(queue, (WorkerTask){formula->calculate[PRECISION_DOUBLE], target, maxIters,
+            formula->paramR, formula->paramI,
+            centerX, centerY, pixelStep, width, height,
+            0, 0, false, 0, 0, false,
+            top, bottom, 0, width, false, 0, 0});
+    }
+    runTasks(queue);
+    free(queue);
+}
+
+CertifyStats renderCertified(
+    const Formula *formula, fracInt *target,
+    double centerX, double centerY, double pixelStep, int width, int height
+) {
+    CertifyStats stats = { 0 };
+    LARGE_INTEGER perfFrequency, perfStart, perfEnd;
+    QueryPerformanceFrequency(&perfFrequency);
+    QueryPerformanceCounter(&perfStart);
+
+    CertifyCounts *counts = calloc(workerThreadCount, sizeof(CertifyCounts));
+    TaskQueue *queue = calloc(1, sizeof(TaskQueue));
+    // Whole rows of tiles per task
+    int tileRows = (height + CERTIFY_TILE - 1) / CERTIFY_TILE;
+    int tasksTotal = min(tuning.maxTasks, tileRows);
+    for (int t = 0; t < tasksTotal; t++) {
+        int top = tileRows * t / tasksTotal * CERTIFY_TILE, bottom = min(height, tileRows * (t + 1) / tasksTotal * CERTIFY_TILE);
+        if (bottom <= top) continue;
+        queueTask(queue, (WorkerTask){
+            .kind = TASK_CERTIFY, .formula = formula, .certifyCounts = counts,
+            .calculate = formula->calculate[PRECISION_DOUBLE], .target = target, .maxIters = maxIters,
+            .paramR = formula->paramR, .paramI = formula->paramI,
+            .centerX = centerX, .centerY = centerY, .pixelStep = pixelStep,
+            .width = width, .height = height, .yStart = top, .yEnd = bottom,
+        });
+    }
+    runTasks(queue);
+    free(queue);
+    QueryPerformanceCounter(&perfEnd);
+
+    for (unsigned int worker = 0; worker < workerThreadCount; worker++) {
+        stats.certified += counts[worker].certified;
+        stats.tilesProven += counts[worker].proven;
+        stats.tilesTried += counts[worker].tried;
+    }
+    free(counts);
+    stats.ms = (double)(perfEnd.QuadPart - perfStart.QuadPart) * 1000 / perfFrequency.QuadPart;
+    return stats;
+}
+
+/** Edges are where the iteration count jumps by more than threshold and the palette shows it */
+bool isEdge(fracInt a, fracInt b, int threshold) {
+    return threshold < 0 || (abs(a - b) > threshold && paletteColor(a) != paletteColor(b));
+}
+
+StillStats renderStill(
+    const Formula *formula, uint32_t *pixels,
+    double centerX, double centerY, double pixelStep, int width, int height,
+    int samples, int threshold, bool certify
+) {
+    StillStats stats = { 0 };
+    samples = min(AA_MAX_SAMPLES, max(1, samples));
+    int count = width * height;
+    fracInt *iterations = malloc(count * sizeof(fracInt));
+    LARGE_INTEGER perfFrequency, perfStart, perfMain, perfEnd;
+    QueryPerformanceFrequency(&perfFrequency);
+    QueryPerformanceCounter(&perfStart);
+
+    if (certify)
+        stats.certified = renderCertified(formula, iterations, centerX, centerY, pixelStep, width, height).certified;
+    else
+        renderBlocking(formula, iterations, centerX, centerY, pixelStep, width, height);
+    for (int i = 0; i < count; i++) {
+        pixels[i] = paletteColor(iterations[i]);
+    }
+    QueryPerformanceCounter(&perfMain);
+
+    // Flag both pixels of every differing right and bottom neighbour pair
+    bool *edge = calloc(count, sizeof(bool));
+    for (int py = 0; py < height; py++) {
+        for (int px = 0; px < width; px++) {
+            int i = py * width + px;
+            if (px + 1 < width && isEdge(iterations[i], iterations[i + 1], threshold))
+                edge[i] = edge[i + 1] = true;
+            if (py + 1 < height && isEdge(iterations[i], iterations[i + width], threshold))
+                edge[i] = edge[i + width] = true;
+        }
+    }
+    int *pixelList = malloc(count * sizeof(int));
+    for (int i = 0; i < count; i++) {
+        if (edge[i]) pixelList[stats.supersampled++] = i;
+    }
+    free(edge);
+
+    // Supersample pass, split by list position so that every task gets a similar share of edges
+    if (stats.supersampled > 0) {
+        TaskQueue *queue = calloc(1, sizeof(TaskQueue));
+        int tasksTotal = min(tuning.maxTasks, max(workerThreadCount * 4, stats.supersampled / 256));
+        for (int t = 0; t < tasksTotal; t++) {
+            int listStart = (int)((int64_t)stats.supersampled * t / tasksTotal);
+            int listEnd = (int)((int64_t)stats.supersampled * (t + 1) / tasksTotal);
+            if (listEnd - listStart == 0) continue;
+            queueTask(queue, (WorkerTask){
+                .calculate = formula->calculate[PRECISION_DOUBLE], .maxIters = maxIters,
+                .paramR = formula->paramR, .paramI = formula->paramI,
+                .centerX = centerX, .centerY = centerY, .pixelStep = pixelStep,
+                .width = width, .height = height,
+                .kind = TASK_SUPERSAMPLE, .colors = pixels,
+                .pixelList = pixelList, .listStart = listStart, .listEnd = listEnd,
+                .samples = samples,
+            });
+        }
+        runTasks(queue);
+        free(queue);
+    }
+    QueryPerformanceCounter(&perfEnd);
+
+    free(pixelList);
+    free(iterations);
+    stats.mainMs = (double)(perfMain.QuadPart - perfStart.QuadPart) * 1000 / perfFrequency.QuadPart;
+    stats.supersampleMs = (double)(perfEnd.QuadPart - perfMain.QuadPart) * 1000 / perfFrequency.QuadPart;
+    return stats;
 }
 
-void zoomFrame(int xPixel, int yPixel, int level) {
-    if (WaitForSingleObject(statusSemaphore, 100) != 0) return;
+ResumeStats renderResumable(ResumableRender *render, int maxIters) {
+    ResumeStats stats = { 0 };
+    maxIters = min(maxIters, UINT16_MAX);
+    if (maxIters <= render->maxIters) return stats;
+    LARGE_INTEGER perfFrequency, perfStart, perfEnd;
+    QueryPerformanceFrequency(&perfFrequency);
+    QueryPerformanceCounter(&perfStart);
+
+    bool first = render->maxIters == 0;
+    int total = first ? render->width * render->height : render->pointCount;
+    ResumeList *lists = calloc(MAX_QUEUE, sizeof(ResumeList));
+    TaskQueue *queue = calloc(1, sizeof(TaskQueue));
+    int tasksTotal = min(tuning.maxTasks, max((int)workerThreadCount, total / RESUME_TASK_POINTS));
+    for (int t = 0; t < tasksTotal; t++) {
+        int start = (int)((int64_t)total * t / tasksTotal), end = (int)((int64_t)total * (t + 1) / tasksTotal);
+        if (end == start) continue;
+        queueTask(queue, (WorkerTask){
+            .kind = TASK_RESUME, .resumable = render, .resumeList = &lists[queue->total],
+            .listStart = start, .listEnd = end, .fromIters = render->maxIters, .maxIters = maxIters,
+        });
+    }
+    // runTasks clears total
+    int queued = queue->total;
+    runTasks(queue);
+
+    // Tasks are in pixel order, so the points stay in pixel order
+    int inside = 0;
+    for (int t = 0; t < queued; t++)
+        inside += lists[t].count;
+    if (first) {
+        render->points = malloc(max(1, inside) * sizeof(ResumePoint));
+        for (int t = 0, count = 0; t < queued; count += lists[t].count, t++) {
+            memcpy(render->points + count, lists[t].points, lists[t].count * sizeof(ResumePoint));
+            free(lists[t].points);
+        }
+    } else {
+        for (int t = 0, count = 0; t < queued; count += lists[t].count, t++)
+            memmove(render->points + count, render->points + queue->tasks[t].listStart, lists[t].count * sizeof(ResumePoint));
+        render->points = realloc(render->points, max(1, inside) * sizeof(ResumePoint));
+    }
+    free(lists);
+    free(queue);
+    render->pointCount = inside;
+    render->maxIters = maxIters;
+
+    QueryPerformanceCounter(&perfEnd);
+    stats.resumed = total;
+    stats.inside = inside;
+    stats.ms = (double)(perfEnd.QuadPart - perfStart.QuadPart) * 1000 / perfFrequency.QuadPart;
+    return stats;
+}
+
+void resumableFree(ResumableRender *render) {
+    free(render->points);
+    render->points = 0;
+    render->pointCount = 0;
+}
+
+DensityStats renderDensity(DensityRender *density, uint64_t samples) {
+    DensityStats stats = { samples };
+    int count = density->width * density->height;
+    LARGE_INTEGER perfFrequency, perfStart, perfSampled, perfEnd;
+    QueryPerformanceFrequency(&perfFrequency);
+    QueryPerformanceCounter(&perfStart);
+
+    // Every worker hits only its own histogram, so the hot loop needs no atomics
+    uint32_t **histograms = malloc(workerThreadCount * sizeof(uint32_t*));
+    for (unsigned int worker = 0; worker < workerThreadCount; worker++)
+        histograms[worker] = calloc(count, sizeof(uint32_t));
+    DensityCounts *counts = calloc(workerThreadCount, sizeof(DensityCounts));
+    TaskQueue *queue = calloc(1, sizeof(TaskQueue));
+    int tasksTotal = min(tuning.maxTasks, workerThreadCount * DENSITY_TASKS_PER_THREAD);
+    for (int t = 0; t < tasksTotal; t++) {
+        uint64_t sampleStart = density->samples + samples * t / tasksTotal;
+        uint64_t sampleEnd = density->samples + samples * (t + 1) / tasksTotal;
+        if (sampleEnd == sampleStart) continue;
+        queueTask(queue, (WorkerTask){
+            .kind = TASK_DENSITY, .density = density, .histograms = histograms, .counts = counts,
+            .sampleStart = sampleStart, .sampleEnd = sampleEnd,
+        });
+    }
+    runTasks(queue);
+    QueryPerformanceCounter(&perfSampled);
+
+    // Reduction split by rows, each task adds up all histograms for its rows
+    int mergeTotal = min(tuning.maxTasks, min(density->height, (int)workerThreadCount * 4));
+    for (int t = 0; t < mergeTotal; t++) {
+        int top = density->height * t / mergeTotal, bottom = density->height * (t + 1) / mergeTotal;
+        if (bottom == top) continue;
+        queueTask(queue, (WorkerTask){
+            .kind = TASK_DENSITY_MERGE, .density = density, .histograms = histograms,
+            .yStart = top, .yEnd = bottom,
+        });
+    }
+    runTasks(queue);
+    QueryPerformanceCounter(&perfEnd);
+
+    for (unsigned int worker = 0; worker < workerThreadCount; worker++) {
+        stats.skipped += counts[worker].skipped;
+        stats.recorded += counts[worker].recorded;
+        free(histograms[worker]);
+    }
+    free(histograms);
+    free(counts);
+    free(queue);
+    density->samples += samples;
+    stats.sampleMs = (double)(perfSampled.QuadPart - perfStart.QuadPart) * 1000 / perfFrequency.QuadPart;
+    stats.mergeMs = (double)(perfEnd.QuadPart - perfSampled.QuadPart) * 1000 / perfFrequency.QuadPart;
+    return stats;
+}
+
+void densityColors(const DensityRender *density, uint32_t *pixels) {
+    int count = density->width * density->height;
+    uint64_t most = 1;
+    for (int i = 0; i < count; i++)
+        most = max(most, density->histogram[i]);
+    double scale = 1 / sqrt((double)most);
+    for (int i = 0; i < count; i++) {
+        double value = sqrt((double)density->histogram[i]) * scale;
+        // Warm white, blue fading out first
+        pixels[i] = (uint32_t)(255 * value) << 16 | (uint32_t)(255 * pow(value, 1.2)) << 8 | (uint32_t)(255 * pow(value, 1.6));
+    }
+}
+
+void panFrame(Renderer *renderer, int xPixels, int yPixels) {
+    if (WaitForSingleObject(renderer->statusSemaphore, 100) != 0) return;
+    renderer->desiredOffsetX -= (double)xPixels * getCurrentPixelStep(renderer);
+    renderer->desiredOffsetY -= (double)yPixels * getCurrentPixelStep(renderer);
+    setInteraction(renderer, INTERACTION_PAN);
+    ReleaseSemaphore(renderer->statusSemaphore, 1, NULL);
+}
+
+void zoomFrame(Renderer *renderer, int xPixel, int yPixel, int level) {
+    if (WaitForSingleObject(renderer->statusSemaphore, 100) != 0) return;
     if (level > 0) {
-        desiredZoom *= 1.5;
+        renderer->desiredZoom *= 1.5;
     }
     if (level < 0) {
-        desiredZoom /= 1.5;
+        renderer->desiredZoom /= 1.5;
+    }
+    setInteraction(renderer, INTERACTION_ZOOM);
+    ReleaseSemaphore(renderer->statusSemaphore, 1, NULL);
+}
+
+void setFormula(Renderer *renderer, int formula) {
+    if (formula < 0 || formula >= FORMULA_COUNT) return;
+    if (WaitForSingleObject(renderer->statusSemaphore, INFINITE) != 0) return;
+    renderer->desiredFormula = &formulas[formula];
+    renderer->desiredZoom = formulas[formula].zoom;
+    renderer->desiredZoomSize = min(renderer->desiredWidth, renderer->desiredHeight);
+    renderer->desiredOffsetX = formulas[formula].offsetX;
+    renderer->desiredOffsetY = formulas[formula].offsetY;
+    setInteraction(renderer, INTERACTION_ZOOM);
+    ReleaseSemaphore(renderer->statusSemaphore, 1, NULL);
+    if (DEBUG_THREAD) printf("Formula %s\n", formulas[formula].name);
+}
+
+/** Keeps the pixel step, a larger frame shows more of the view */
+void resizeFrame(Renderer *renderer, int width, int height) {
+    if (WaitForSingleObject(renderer->statusSemaphore, INFINITE) != 0) return;
+    if (width != renderer->desiredWidth || height != renderer->desiredHeight) {
+        renderer->resizeCount++;
+        QueryPerformanceCounter(&renderer->resizeTime);
+        setInteraction(renderer, INTERACTION_RESIZE);
     }
-    ReleaseSemaphore(statusSemaphore, 1, NULL);
+    renderer->desiredWidth = width;
+    renderer->desiredHeight = height;
+    // The first real size decides what the initial zoom spans
+    if (!renderer->desiredZoomSize && min(width, height) >= 4) renderer->desiredZoomSize = min(width, height);
+    ReleaseSemaphore(renderer->statusSemaphore, 1, NULL);
 }
 
-void resizeFrame(int width, int height) {
-    if (WaitForSingleObject(statusSemaphore, INFINITE) != 0) return;
-    desiredWidth = width;
-    desiredHeight = height;
-    ReleaseSemaphore(statusSemaphore, 1, NULL);
+bool rendererFrameStatus(Renderer *renderer, FrameStatus *status) {
+    if (WaitForSingleObject(renderer->statusSemaphore, 100) != 0) return false;
+    DesiredParams target = getCurrentDesired(renderer);
+    ReleaseSemaphore(renderer->statusSemaphore, 1, NULL);
+    if (waitForBufferSemaphore(renderer, 100, 'S') != 0) return false;
+
+    DesiredParams shown = renderer->mainBuffer.params;
+    status->tag = renderer->mainBuffer.tag;
+    status->current = renderer->mainBuffer.array && shown.width == target.width && shown.height == target.height
+        && shown.pixelStep == target.pixelStep && shown.offsetX == target.offsetX && shown.offsetY == target.offsetY
+        && shown.formula == target.formula;
+    status->complete = status->current && progressive_done(renderer->mainBuffer) && renderer->mainBuffer.firstPassIters == maxIters
+        && !renderer->mainBuffer.missingL && !renderer->mainBuffer.missingR && !renderer->mainBuffer.missingT && !renderer->mainBuffer.missingB;
+    releaseBufferSemaphore(renderer, 'S');
+    return true;
+}
+
+double rendererWorkerMs() {
+    LARGE_INTEGER perfFrequency;
+    QueryPerformanceFrequency(&perfFrequency);
+    return (double)workerBusyTicks * 1000 / perfFrequency.QuadPart;
 }
 
 int lastDraw = -1;
-bool tryRedraw32(uint32_t *pixels, int width, int height) {
-    if (waitForBufferSemaphore(100, 'D') != 0) return false;
+bool tryRedraw32(Renderer *renderer, uint32_t *pixels, int width, int height) {
+    if (WaitForSingleObject(renderer->statusSemaphore, 100) != 0) return false;
+    DesiredParams target = getCurrentDesired(renderer);
+    ReleaseSemaphore(renderer->statusSemaphore, 1, NULL);
+    if (waitForBufferSemaphore(renderer, 100, 'D') != 0) return false;
 
     if (DEBUG_REDRAW)
         printf("bfr.array %p, bfr.w %d == %d, bfr.h %d == %d\n",
-            mainBuffer.array, mainBuffer.params.width, width, mainBuffer.params.height, height);
-    if (mainBuffer.array && mainBuffer.params.width == width && mainBuffer.params.height == height) {
+            renderer->mainBuffer.array, renderer->mainBuffer.params.width, width, renderer->mainBuffer.params.height, height);
+    if (renderer->mainBuffer.array && renderer->mainBuffer.params.width == width && renderer->mainBuffer.params.height == height) {
         memset(pixels, 0, width * height * sizeof(uint32_t));
         uint8_t *pixelData = (uint8_t*)pixels;
         
         for (int i = 0; i < width * height; i++) {
-            int value = mainBuffer.array[i];
+            int value = renderer->mainBuffer.array[i];
             pixelData[i * 4 + 2] = palette[value * 4];
             pixelData[i * 4 + 1] = palette[value * 4 + 1];
             pixelData[i * 4 + 0] = palette[value * 4 + 2];
         }
         
-        releaseBufferSemaphore('D');
+        releaseBufferSemaphore(renderer, 'D');
+        return true;
+    }
+    // Frame was resized before renderer->mainBuffer, preview it scaled to the desired view with the rest black
+    if (renderer->mainBuffer.array && renderer->mainBuffer.params.pixelStep > 0 && width == target.width && height == target.height) {
+        DesiredParams source = renderer->mainBuffer.params;
+        double scale = target.pixelStep / source.pixelStep;
+        double startX = floor((float)source.width / 2) + (target.offsetX - source.offsetX) / source.pixelStep
+            - floor((float)width / 2) * scale;
+        double startY = floor((float)source.height / 2) + (target.offsetY - source.offsetY) / source.pixelStep
+            - floor((float)height / 2) * scale;
+        for (int y = 0; y < height; y++) {
+            int sourceY = (int)round(startY + y * scale);
+            uint32_t *row = pixels + y * width;
+            if (sourceY < 0 || sourceY >= source.height) {
+                memset(row, 0, width * sizeof(uint32_t));
+                continue;
+            }
+            for (int x = 0; x < width; x++) {
+                int sourceX = (int)round(startX + x * scale);
+                row[x] = sourceX < 0 || sourceX >= source.width ? 0
+                    : paletteColor(renderer->mainBuffer.array[sourceY * source.width + sourceX]);
+            }
+        }
+        releaseBufferSemaphore(renderer, 'D');
         return true;
     }
-    releaseBufferSemaphore('D');
+    releaseBufferSemaphore(renderer, 'D');
     return false;
 }
@@ -1,8 +1,177 @@
+#pragma once
+
 #include <stdbool.h>
 
+#include "mandelbrot.h"
+
+/** One interactive view with its own buffers and threads, the worker threads are shared by all */
+typedef struct Renderer Renderer;
+
+/** Knobs that trade overhead against load balance and latency, their best values differ by machine */
+typedef struct {
+    /** Worker threads when rendererInitialize gets 0 */
+    unsigned int threads;
+    /** Most tasks a render is split into, at most 256 */
+    int maxTasks;
+    /** Area of the pixels uncovered by a pan per task */
+    int panTaskPixels;
+    /** Progressive passes are calculated together while their predicted time stays below this */
+    int progressiveBudgetMs;
+} RendererTuning;
+
+extern const RendererTuning defaultTuning;
+/** Profile written by tune, relative to the working directory */
+#define TUNING_PATH "tuning.cfg"
+
+/**
+ * Starts the worker pool, call before anything else. Loads the tuning profile at TUNING_PATH
+ * when it was written on this machine, otherwise uses defaultTuning. threadCount 0 takes the profile's threads.
+ */
 int rendererInitialize(unsigned int threadCount);
+/** Stops the worker pool, it can be initialized again afterwards */
 void rendererExit();
-bool tryRedraw32(uint32_t *pixels, int width, int height);
-void resizeFrame(int width, int height);
-void panFrame(int xPixels, int yPixels);
-void zoomFrame(int xPixel, int yPixel, int level);
+/** Worker threads rendererInitialize started */
+unsigned int rendererThreadCount();
+RendererTuning rendererTuning();
+/** Replaces the tuning for renders started afterwards, the threads only apply to the next rendererInitialize */
+void rendererSetTuning(const RendererTuning *tuning);
+/** Reads a profile, false when there is none or it was written on another machine */
+bool loadTuning(const char *path, RendererTuning *tuning);
+/** Writes a profile for this machine, returns 0 on success */
+int saveTuning(const char *path, const RendererTuning *tuning);
+/** Returns 0 on failure */
+Renderer *rendererCreate();
+void rendererDestroy(Renderer *renderer);
+/** Optional, views stored in the tile pyramid at path are paged in instead of rendered */
+int rendererOpenTiles(Renderer *renderer, const char *path);
+/**
+ * Optional, publishes every new frame up to maxWidth x maxHeight to the shared memory ring name (see framering.h)
+ * with its iteration counts, its colors as BGRA or both. Returns 0 on success.
+ */
+int rendererExportFrames(Renderer *renderer, const char *name, int maxWidth, int maxHeight, bool iters, bool bgra);
+bool tryRedraw32(Renderer *renderer, uint32_t *pixels, int width, int height);
+typedef struct {
+    /** Changes with every new frame */
+    int tag;
+    /** The frame shows the view of the latest input, maybe still coarse or with parts missing */
+    bool current;
+    /** Current and calculated at full quality everywhere */
+    bool complete;
+} FrameStatus;
+/** Returns false when the buffers were busy */
+bool rendererFrameStatus(Renderer *renderer, FrameStatus *status);
+/** Time all worker threads spent on tasks so far, added up */
+double rendererWorkerMs();
+void resizeFrame(Renderer *renderer, int width, int height);
+void panFrame(Renderer *renderer, int xPixels, int yPixels);
+void zoomFrame(Renderer *renderer, int xPixel, int yPixel, int level);
+/** Switches to formulas[formula] at its initial view */
+void setFormula(Renderer *renderer, int formula);
+typedef struct {
+    /** Pixels flagged as edges and supersampled */
+    int supersampled;
+    /** Pixels of the main pass filled from a proof, with certify */
+    int certified;
+    double mainMs;
+    double supersampleMs;
+} StillStats;
+
+/** Workers hand out tasks of a higher priority first, renderers' own tasks are interactive */
+typedef enum {
+    RENDER_PRIORITY_BATCH,
+    RENDER_PRIORITY_INTERACTIVE,
+} RenderPriority;
+
+/** Renders into target using the worker threads and waits for the result */
+void renderBlocking(const Formula *formula, fracInt *target, double centerX, double centerY, double pixelStep, int width, int height);
+/** Same as renderBlocking with the tasks handed out at priority */
+void renderPrioritized(
+    RenderPriority priority, const Formula *formula, fracInt *target,
+    double centerX, double centerY, double pixelStep, int width, int height
+);
+typedef struct {
+    /** Pixels filled from a proof instead of calculated */
+    int certified;
+    /** Tiles proven and tiles tried, including the parts of failed ones */
+    int tilesProven; int tilesTried;
+    double ms;
+} CertifyStats;
+/**
+ * Same result as renderBlocking, but tiles are first iterated as a whole with interval arithmetic (see certifyTile).
+ * Tiles proven to escape at the same iteration or stay inside are filled, the others are split and tried again,
+ * the smallest ones that still fail are calculated per pixel.
+ */
+CertifyStats renderCertified(
+    const Formula *formula, fracInt *target,
+    double centerX, double centerY, double pixelStep, int width, int height
+);
+/**
+ * Renders an anti-aliased still into pixels (0x00RRGGBB) using the worker threads.
+ * Pixels whose iteration count differs from a neighbour by more than threshold are supersampled
+ * with samples x samples, threshold < 0 supersamples every pixel. With certify the main pass uses renderCertified.
+ */
+StillStats renderStill(
+    const Formula *formula, uint32_t *pixels,
+    double centerX, double centerY, double pixelStep, int width, int height,
+    int samples, int threshold, bool certify
+);
+
+/**
+ * Render whose iteration limit can be raised afterwards: the z of every pixel still inside at the limit is kept
+ * in a list, so a higher limit continues only those pixels from where they stopped instead of starting all over.
+ */
+typedef struct {
+    const Formula *formula;
+    int width; int height;
+    double centerX; double centerY; double pixelStep;
+    /** width * height iterations, allocated by the caller */
+    fracInt *iterations;
+    /** Limit iterated to so far, 0 before the first render */
+    int maxIters;
+    /** Pixels still inside at maxIters in pixel order, owned by the render */
+    ResumePoint *points;
+    int pointCount;
+} ResumableRender;
+typedef struct {
+    /** Pixels iterated, every pixel for the first render */
+    int resumed;
+    /** Of those still inside at the new limit */
+    int inside;
+    double ms;
+} ResumeStats;
+
+/** Renders or continues render up to maxIters, at most the largest fracInt, using the worker threads */
+ResumeStats renderResumable(ResumableRender *render, int maxIters);
+/** Frees the points, the iterations stay with the caller */
+void resumableFree(ResumableRender *render);
+
+/**
+ * Orbit density (Buddhabrot) of the Mandelbrot formula: every sampled c whose orbit escapes after
+ * [minIters, maxIters) iterations, or with anti never escapes, adds a hit to every pixel its orbit visits.
+ * Sample n is always the same c, so a saved histogram resumes sampling from samples.
+ */
+typedef struct {
+    int width; int height;
+    double centerX; double centerY; double pixelStep;
+    int minIters; int maxIters;
+    bool anti;
+    /** Samples taken so far */
+    uint64_t samples;
+    /** width * height hits, allocated by the caller */
+    uint64_t *histogram;
+} DensityRender;
+typedef struct {
+    uint64_t samples;
+    /** Samples inside the main cardioid or period 2 bulb, not iterated */
+    uint64_t skipped;
+    /** Samples whose orbit was added */
+    uint64_t recorded;
+    double sampleMs;
+    /** Adding up the per thread histograms */
+    double mergeMs;
+} DensityStats;
+
+/** Takes samples more samples on the worker threads and adds their hits to density->histogram */
+DensityStats renderDensity(DensityRender *density, uint64_t samples);
+/** Colors density->histogram into pixels (0x00RRGGBB), brightness by the square root of the hits */
+void densityColors(const DensityRender *density, uint32_t *pixels);
@@ -0,0 +1,176 @@
+#include <windows.h>
+#include <process.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "renderservice.h"
+
+#define DEFAULT_CLIENTS 8
+#define DEFAULT_SECONDS 10
+#define DEFAULT_INTERACTIVE_PERCENT 80
+#define MAX_CLIENTS 64
+#define CONNECT_TIMEOUT_MS 5000
+
+#define INTERACTIVE_WIDTH 320
+#define INTERACTIVE_HEIGHT 240
+#define BATCH_WIDTH 960
+#define BATCH_HEIGHT 720
+/** Interactive views pan around a hot view by up to this many pixels in steps of PAN_STEP */
+#define PAN_RANGE 32
+#define PAN_STEP 16
+
+/** Views many clients look at, batch requests render the area around them on the same pixel grid */
+static const RenderRequest hotViews[] = {
+    { RENDER_MAGIC, 0, FORMULA_MANDELBROT, 0, 0, -0.74, -0.22, 0.01 * 2 / INTERACTIVE_HEIGHT },
+    { RENDER_MAGIC, 0, FORMULA_MANDELBROT, 0, 0, -0.7436, 0.1318, 0.0005 * 2 / INTERACTIVE_HEIGHT },
+    { RENDER_MAGIC, 0, FORMULA_JULIA, 0, 0, 0, 0, 1.6 * 2 / INTERACTIVE_HEIGHT },
+    { RENDER_MAGIC, 0, FORMULA_BURNING_SHIP, 0, 0, -1.76, -0.03, 0.05 * 2 / INTERACTIVE_HEIGHT },
+};
+#define HOT_VIEW_COUNT (int)(sizeof(hotViews) / sizeof(hotViews[0]))
+
+typedef struct {
+    unsigned int seed;
+    /** Latencies in ms per priority */
+    double *latencies[2];
+    int counts[2];
+    int capacities[2];
+    int sources[RENDER_SOURCE_COUNT];
+    int busy;
+    int errors;
+} Client;
+
+static int interactivePercent = DEFAULT_INTERACTIVE_PERCENT;
+static LARGE_INTEGER perfFrequency, perfEnd;
+
+static int nextRandom(Client *client, int range) {
+    client->seed = client->seed * 1103515245 + 12345;
+    return (client->seed >> 8) % range;
+}
+
+static RenderRequest makeRequest(Client *client) {
+    RenderRequest request = hotViews[nextRandom(client, HOT_VIEW_COUNT)];
+    if (nextRandom(client, 100) < interactivePercent) {
+        request.priority = RENDER_PRIORITY_INTERACTIVE;
+        request.width = INTERACTIVE_WIDTH;
+        request.height = INTERACTIVE_HEIGHT;
+        int steps = 2 * PAN_RANGE / PAN_STEP + 1;
+        request.centerX += request.pixelStep * (nextRandom(client, steps) * PAN_STEP - PAN_RANGE);
+        request.centerY += request.pixelStep * (nextRandom(client, steps) * PAN_STEP - PAN_RANGE);
+    } else {
+        request.priority = RENDER_PRIORITY_BATCH;
+        request.width = BATCH_WIDTH;
+        request.height = BATCH_HEIGHT;
+    }
+    return request;
+}
+
+unsigned __stdcall ClientThreadFunction( void* pArguments ) {
+    Client *client = pArguments;
+    HANDLE pipe = INVALID_HANDLE_VALUE;
+    for (int waited = 0; waited < CONNECT_TIMEOUT_MS; waited += 10) {
+        pipe = CreateFileA(RENDER_PIPE_NAME, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+        if (pipe != INVALID_HANDLE_VALUE) break;
+        Sleep(10);
+    }
+    if (pipe == INVALID_HANDLE_VALUE) {
+        client->errors++;
+        return 1;
+    }
+
+    fracInt *pixels = malloc(BATCH_WIDTH * BATCH_HEIGHT * sizeof(fracInt));
+    LARGE_INTEGER perfStart, perfNow;
+    while (true) {
+        QueryPerformanceCounter(&perfStart);
+        if (perfStart.QuadPart >= perfEnd.QuadPart) break;
+        RenderRequest request = makeRequest(client);
+        RenderResponse response;
+        if (!pipeWrite(pipe, &request, sizeof(request)) || !pipeRead(pipe, &response, sizeof(response))) {
+            client->errors++;
+            break;
+        }
+        if (response.status == RENDER_BUSY) {
+            client->busy++;
+            Sleep(1);
+            continue;
+        }
+        if (response.status != RENDER_OK || response.width != request.width || response.height != request.height
+            || !pipeRead(pipe, pixels, (size_t)response.width * response.height * sizeof(fracInt))) {
+            client->errors++;
+            break;
+        }
+        QueryPerformanceCounter(&perfNow);
+
+        int priority = request.priority;
+        if (client->counts[priority] >= client->capacities[priority]) {
+            client->capacities[priority] = client->capacities[priority] * 2 + 256;
+            client->latencies[priority] = realloc(client->latencies[priority], client->capacities[priority] * sizeof(double));
+        }
+        client->latencies[priority][client->counts[priority]++] =
+            (double)(perfNow.QuadPart - perfStart.QuadPart) * 1000 / perfFrequency.QuadPart;
+        if (response.source < RENDER_SOURCE_COUNT) client->sources[response.source]++;
+    }
+    free(pixels);
+    CloseHandle(pipe);
+    return 0;
+}
+
+static int compareDouble(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Load generator for renderd: every client connects once and sends requests back to back,
+ * interactive ones for views panned around a few hot views and batch ones for the area around them.
+ */
+int main(int argc, char **argv) {
+    int clientCount = argc > 1 ? atoi(argv[1]) : DEFAULT_CLIENTS;
+    int seconds = argc > 2 ? atoi(argv[2]) : DEFAULT_SECONDS;
+    if (argc > 3) interactivePercent = atoi(argv[3]);
+    if (clientCount < 1 || clientCount > MAX_CLIENTS || seconds < 1) {
+        fprintf(stderr, "Usage: renderload [clients (1-%d)] [seconds] [interactive percent]\n", MAX_CLIENTS);
+        return 1;
+    }
+
+    QueryPerformanceFrequency(&perfFrequency);
+    QueryPerformanceCounter(&perfEnd);
+    perfEnd.QuadPart += seconds * perfFrequency.QuadPart;
+    static Client clients[MAX_CLIENTS];
+    HANDLE threads[MAX_CLIENTS];
+    for (int i = 0; i < clientCount; i++) {
+        clients[i].seed = i * 7919 + 1;
+        threads[i] = (HANDLE)_beginthreadex(NULL, 0, ClientThreadFunction, &clients[i], 0, NULL);
+    }
+    for (int i = 0; i < clientCount; i++) {
+        if (!threads[i]) continue;
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+
+    const char *priorityNames[] = { "batch", "interactive" };
+    int total = 0, sources[RENDER_SOURCE_COUNT] = { 0 }, busy = 0, errors = 0;
+    for (int priority = RENDER_PRIORITY_INTERACTIVE; priority >= RENDER_PRIORITY_BATCH; priority--) {
+        int count = 0;
+        for (int i = 0; i < clientCount; i++) count += clients[i].counts[priority];
+        double *latencies = malloc((count + 1) * sizeof(double));
+        for (int i = 0, at = 0; i < clientCount; i++) {
+            memcpy(latencies + at, clients[i].latencies[priority], clients[i].counts[priority] * sizeof(double));
+            at += clients[i].counts[priority];
+        }
+        qsort(latencies, count, sizeof(double), compareDouble);
+        if (count) printf("%-11s %6d requests, %7.1f/s, p50 %7.2fms, p99 %7.2fms\n", priorityNames[priority], count,
+            (double)count / seconds, latencies[count / 2], latencies[count * 99 / 100]);
+        total += count;
+        free(latencies);
+    }
+    for (int i = 0; i < clientCount; i++) {
+        for (int source = 0; source < RENDER_SOURCE_COUNT; source++) sources[source] += clients[i].sources[source];
+        busy += clients[i].busy;
+        errors += clients[i].errors;
+    }
+    printf("%d requests, %.1f/s from %d clients: %d rendered, %d shared, %d cropped, %d busy, %d errors\n",
+        total, (double)total / seconds, clientCount, sources[RENDER_RENDERED], sources[RENDER_SHARED],
+        sources[RENDER_CROPPED], busy, errors);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <windows.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "renderer.h"
+
+/**
+ * Protocol of renderd: a client connects to the pipe and sends RenderRequest,
+ * the service answers each one with RenderResponse followed by width * height fracInt on success.
+ * A connection may send any number of requests one after another.
+ */
+#define RENDER_PIPE_NAME "\\\\.\\pipe\\brotRender"
+#define RENDER_MAGIC 0x44524252
+/** Largest width and height served */
+#define RENDER_MAX_SIZE 4096
+
+typedef struct {
+    uint32_t magic;
+    /** RenderPriority, interactive requests are rendered before batch ones */
+    uint32_t priority;
+    /** Index into formulas */
+    uint32_t formula;
+    uint32_t width;
+    uint32_t height;
+    /** Pixel (px, py) lies at centerX + pixelStep * (px - width / 2), same for y */
+    double centerX;
+    double centerY;
+    double pixelStep;
+} RenderRequest;
+
+typedef enum {
+    RENDER_OK,
+    RENDER_INVALID,
+    /** Too many requests in flight, try again later */
+    RENDER_BUSY,
+} RenderStatus;
+
+/** How a request got its pixels */
+typedef enum {
+    /** Rendered for it */
+    RENDER_RENDERED,
+    /** Identical to a request in flight, both got the same render */
+    RENDER_SHARED,
+    /** Cut out of a larger render in flight on the same pixel grid */
+    RENDER_CROPPED,
+    RENDER_SOURCE_COUNT
+} RenderSource;
+
+typedef struct {
+    uint32_t status;
+    uint32_t source;
+    uint32_t width;
+    uint32_t height;
+    /** Time from arrival until the render started and how long the render took */
+    double waitMs;
+    double renderMs;
+} RenderResponse;
+
+/** ReadFile of a byte pipe may return less than asked for */
+static inline bool pipeRead(HANDLE pipe, void *data, size_t bytes) {
+    for (size_t done = 0; done < bytes; ) {
+        DWORD count = 0;
+        if (!ReadFile(pipe, (uint8_t*)data + done, (DWORD)(bytes - done), &count, NULL) || count == 0) return false;
+        done += count;
+    }
+    return true;
+}
+
+static inline bool pipeWrite(HANDLE pipe, const void *data, size_t bytes) {
+    for (size_t done = 0; done < bytes; ) {
+        DWORD count = 0;
+        if (!WriteFile(pipe, (const uint8_t*)data + done, (DWORD)(bytes - done), &count, NULL) || count == 0) return false;
+        done += count;
+    }
+    return true;
+}
@@ -0,0 +1,177 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "renderer.h"
+#include "replay.h"
+
+#define FRAME_RATE 60
+/** Frame status is checked this often in ms, the display only every frame */
+#define POLL_MS 1
+/** After the last event the replay waits this long at most for the frame to complete */
+#define SETTLE_MS 10000
+
+typedef struct {
+    ReplayEvent event;
+    /** When it was given to the renderer in ms since the replay started */
+    double issuedMs;
+    /** Time until the first frame showing it or a later input and until such a frame was complete, -1 until then */
+    double updatedMs;
+    double completeMs;
+} Sample;
+
+static int compareDouble(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+/** Prints p50/p95/p99 of the latencies of the samples of kind, every kind for REPLAY_KIND_COUNT */
+static void printLatencies(const Sample *samples, int count, int kind) {
+    double *updated = malloc((count + 1) * sizeof(double)), *complete = malloc((count + 1) * sizeof(double));
+    int updatedCount = 0, completeCount = 0, events = 0;
+    for (int i = 0; i < count; i++) {
+        if (kind != REPLAY_KIND_COUNT && samples[i].event.kind != kind) continue;
+        events++;
+        if (samples[i].updatedMs >= 0) updated[updatedCount++] = samples[i].updatedMs;
+        if (samples[i].completeMs >= 0) complete[completeCount++] = samples[i].completeMs;
+    }
+    if (events) {
+        qsort(updated, updatedCount, sizeof(double), compareDouble);
+        qsort(complete, completeCount, sizeof(double), compareDouble);
+        printf("%-7s %6d events, first frame", kind == REPLAY_KIND_COUNT ? "all" : replayKindNames[kind], events);
+        if (updatedCount) printf(" p50 %7.1fms p95 %7.1fms p99 %7.1fms,", updated[updatedCount / 2],
+            updated[updatedCount * 95 / 100], updated[updatedCount * 99 / 100]);
+        printf(" complete");
+        if (completeCount) printf(" p50 %7.1fms p95 %7.1fms p99 %7.1fms", complete[completeCount / 2],
+            complete[completeCount * 95 / 100], complete[completeCount * 99 / 100]);
+        if (completeCount < events) printf(" (%d never)", events - completeCount);
+        printf("\n");
+    }
+    free(updated);
+    free(complete);
+}
+
+/**
+ * Drives a renderer without a window with input recorded by the viewer, at the original pace or speed times faster,
+ * and measures for every event how long it took until a frame showed it and until that frame was complete.
+ * The display is redrawn FRAME_RATE times per second like in the viewer, a display frame counts as dropped
+ * when an input was waiting to be shown and no new frame had arrived since the last one.
+ */
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: replay <recording> [speed] [threads]\n");
+        return 1;
+    }
+    double speed = argc > 2 ? atof(argv[2]) : 1;
+    unsigned int threadCount = argc > 3 ? atoi(argv[3]) : 0;
+    if (speed <= 0) {
+        fprintf(stderr, "Invalid speed\n");
+        return 1;
+    }
+
+    FILE *file = fopen(argv[1], "r");
+    if (!file) {
+        fprintf(stderr, "Could not open %s\n", argv[1]);
+        return 1;
+    }
+    Sample *samples = 0;
+    int count = 0, capacity = 0, maxWidth = 1, maxHeight = 1;
+    ReplayEvent event;
+    while (replayRead(file, &event)) {
+        if (count >= capacity) {
+            capacity = capacity * 2 + 256;
+            samples = realloc(samples, capacity * sizeof(Sample));
+        }
+        samples[count++] = (Sample){ event, 0, -1, -1 };
+        if (event.kind == REPLAY_RESIZE) {
+            maxWidth = max(maxWidth, event.a);
+            maxHeight = max(maxHeight, event.b);
+        }
+    }
+    fclose(file);
+    if (!count) {
+        fprintf(stderr, "No events in %s\n", argv[1]);
+        return 1;
+    }
+
+    if (rendererInitialize(threadCount)) {
+        fprintf(stderr, "Error initializing renderer\n");
+        rendererExit();
+        return 1;
+    }
+    Renderer *renderer = rendererCreate();
+    if (!renderer) {
+        fprintf(stderr, "Error creating renderer\n");
+        rendererExit();
+        return 1;
+    }
+    uint32_t *pixels = malloc((size_t)maxWidth * maxHeight * sizeof(uint32_t));
+    int width = 0, height = 0;
+
+    LARGE_INTEGER perfFrequency, perfStart, perfNow;
+    QueryPerformanceFrequency(&perfFrequency);
+    QueryPerformanceCounter(&perfStart);
+    double workerMsStart = rendererWorkerMs();
+    double lastEventMs = samples[count - 1].event.ms / speed, nextFrameMs = 0, nowMs = 0;
+    // Events before these are shown and complete
+    int issued = 0, firstNotUpdated = 0, firstNotComplete = 0;
+    int frames = 0, staleFrames = 0, droppedFrames = 0, frameTag = -1;
+    FrameStatus status = { 0 };
+    while (firstNotComplete < count) {
+        QueryPerformanceCounter(&perfNow);
+        nowMs = (double)(perfNow.QuadPart - perfStart.QuadPart) * 1000 / perfFrequency.QuadPart;
+        if (nowMs > lastEventMs + SETTLE_MS) break;
+
+        for (; issued < count && samples[issued].event.ms / speed <= nowMs; issued++) {
+            ReplayEvent event = samples[issued].event;
+            samples[issued].issuedMs = nowMs;
+            if (event.kind == REPLAY_PAN) {
+                panFrame(renderer, event.a, event.b);
+            } else if (event.kind == REPLAY_ZOOM) {
+                zoomFrame(renderer, event.a, event.b, event.c);
+            } else if (event.kind == REPLAY_RESIZE) {
+                width = event.a;
+                height = event.b;
+                resizeFrame(renderer, width, height);
+            } else if (event.kind == REPLAY_FORMULA) {
+                setFormula(renderer, event.a);
+            }
+        }
+
+        if (rendererFrameStatus(renderer, &status)) {
+            QueryPerformanceCounter(&perfNow);
+            nowMs = (double)(perfNow.QuadPart - perfStart.QuadPart) * 1000 / perfFrequency.QuadPart;
+            for (; status.current && firstNotUpdated < issued; firstNotUpdated++)
+                samples[firstNotUpdated].updatedMs = nowMs - samples[firstNotUpdated].issuedMs;
+            for (; status.complete && firstNotComplete < issued; firstNotComplete++)
+                samples[firstNotComplete].completeMs = nowMs - samples[firstNotComplete].issuedMs;
+        }
+
+        if (nowMs >= nextFrameMs && width > 0 && height > 0) {
+            nextFrameMs += 1000.0 / FRAME_RATE;
+            if (nextFrameMs < nowMs) nextFrameMs = nowMs + 1000.0 / FRAME_RATE;
+            tryRedraw32(renderer, pixels, width, height);
+            frames++;
+            if (firstNotUpdated < issued) {
+                staleFrames++;
+                if (status.tag == frameTag) droppedFrames++;
+            }
+            frameTag = status.tag;
+        }
+        Sleep(POLL_MS);
+    }
+    double workerMs = rendererWorkerMs() - workerMsStart;
+
+    printf("Replayed %d events of %.1fs in %.1fs at %gx speed with %d threads\n",
+        count, samples[count - 1].event.ms / 1000, nowMs / 1000, speed, rendererThreadCount());
+    for (int kind = 0; kind <= REPLAY_KIND_COUNT; kind++) printLatencies(samples, count, kind);
+    printf("%d display frames, %d showed an older view, %d of those dropped without a new frame; workers %.0f%% busy\n",
+        frames, staleFrames, droppedFrames, nowMs > 0 ? 100 * workerMs / (nowMs * rendererThreadCount()) : 0);
+
+    rendererDestroy(renderer);
+    rendererExit();
+    free(pixels);
+    free(samples);
+    return 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Input recorded by the viewer with -record and driven into a renderer by replay.
+ * Text with one event per line: milliseconds since the recording started, the kind and its arguments, like
+ *   0.000 resize 1184 921
+ *   812.406 pan -3 1
+ *   1650.113 zoom 592 460 -1
+ *   2400.000 formula 2
+ */
+typedef enum {
+    /** dx dy in pixels */
+    REPLAY_PAN,
+    /** x y level as zoomFrame takes them */
+    REPLAY_ZOOM,
+    /** width height */
+    REPLAY_RESIZE,
+    /** Index into formulas */
+    REPLAY_FORMULA,
+    REPLAY_KIND_COUNT
+} ReplayKind;
+
+static const char *replayKindNames[REPLAY_KIND_COUNT] = { "pan", "zoom", "resize", "formula" };
+
+typedef struct {
+    double ms;
+    ReplayKind kind;
+    int a; int b; int c;
+} ReplayEvent;
+
+static inline void replayWrite(FILE *file, ReplayEvent event) {
+    fprintf(file, "%.3f %s %d %d %d\n", event.ms, replayKindNames[event.kind], event.a, event.b, event.c);
+}
+
+/** Reads the next event, skipping lines that are not one, false at the end of the file */
+static inline bool replayRead(FILE *file, ReplayEvent *event) {
+    char line[256], kind[16];
+    while (fgets(line, sizeof(line), file)) {
+        *event = (ReplayEvent){ 0 };
+        if (sscanf(line, "%lf %15s %d %d %d", &event->ms, kind, &event->a, &event->b, &event->c) < 2) continue;
+        for (int i = 0; i < REPLAY_KIND_COUNT; i++) {
+            if (strcmp(kind, replayKindNames[i]) == 0) {
+                event->kind = i;
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,135 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "renderer.h"
+#include "bitmap.h"
+#include "iterfile.h"
+
+#define DEFAULT_SAMPLES 3
+#define DEFAULT_THRESHOLD 0
+
+/**
+ * Renders an anti-aliased still of a formula's initial view into a bitmap.
+ * With -compare it also renders the same view fully supersampled and reports the difference.
+ * With -certify the main pass fills tiles proven with interval arithmetic instead of calculating their pixels,
+ * -compare then also checks it against a plain main pass.
+ * A file ending in .iter gets the raw iteration counts instead, for recolor to apply palettes to.
+ */
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: still <file.bmp|file.iter> <width> <height> [samples] [threshold] [threads] [formula] [-compare] [-certify]\n");
+        return 1;
+    }
+    const char *path = argv[1];
+    int width = atoi(argv[2]);
+    int height = atoi(argv[3]);
+    int samples = argc > 4 ? atoi(argv[4]) : DEFAULT_SAMPLES;
+    int threshold = argc > 5 ? atoi(argv[5]) : DEFAULT_THRESHOLD;
+    unsigned int threadCount = argc > 6 ? atoi(argv[6]) : 0;
+    // 1-based like the viewer's number keys
+    int formulaIndex = argc > 7 ? atoi(argv[7]) - 1 : FORMULA_MANDELBROT;
+    bool compare = false, certify = false;
+    for (int i = 8; i < argc; i++) {
+        compare |= strcmp(argv[i], "-compare") == 0;
+        certify |= strcmp(argv[i], "-certify") == 0;
+    }
+    if (width < 1 || height < 1 || formulaIndex < 0 || formulaIndex >= FORMULA_COUNT) {
+        fprintf(stderr, "Invalid size or formula\n");
+        return 1;
+    }
+
+    if (rendererInitialize(threadCount)) {
+        fprintf(stderr, "Error initializing renderer\n");
+        rendererExit();
+        return 1;
+    }
+
+    const Formula *formula = &formulas[formulaIndex];
+    double pixelStep = formula->zoom * 2 / min(width, height);
+    if (certify && compare) {
+        // Proven tiles must not change a single count
+        fracInt *plain = malloc((size_t)width * height * sizeof(fracInt));
+        fracInt *certified = malloc((size_t)width * height * sizeof(fracInt));
+        LARGE_INTEGER perfFrequency, perfStart, perfEnd;
+        QueryPerformanceFrequency(&perfFrequency);
+        QueryPerformanceCounter(&perfStart);
+        renderBlocking(formula, plain, formula->offsetX, formula->offsetY, pixelStep, width, height);
+        QueryPerformanceCounter(&perfEnd);
+        double plainMs = (double)(perfEnd.QuadPart - perfStart.QuadPart) * 1000 / perfFrequency.QuadPart;
+        CertifyStats certifyStats = renderCertified(formula, certified, formula->offsetX, formula->offsetY, pixelStep, width, height);
+        int mismatches = 0;
+        for (int i = 0; i < width * height; i++)
+            mismatches += plain[i] != certified[i];
+        printf("Certified %.1f%% of the area in %d of %d tiles tried, main pass %.1fms against %.1fms plain (%.2fx), %d pixels differ\n",
+            100.0 * certifyStats.certified / (width * height), certifyStats.tilesProven, certifyStats.tilesTried,
+            certifyStats.ms, plainMs, plainMs / certifyStats.ms, mismatches);
+        free(plain);
+        free(certified);
+    }
+    size_t pathLength = strlen(path);
+    if (pathLength > 5 && strcmp(path + pathLength - 5, ".iter") == 0) {
+        fracInt *iterations = malloc((size_t)width * height * sizeof(fracInt));
+        LARGE_INTEGER perfFrequency, perfStart, perfEnd;
+        QueryPerformanceFrequency(&perfFrequency);
+        QueryPerformanceCounter(&perfStart);
+        int certified = 0;
+        if (certify)
+            certified = renderCertified(formula, iterations, formula->offsetX, formula->offsetY, pixelStep, width, height).certified;
+        else
+            renderBlocking(formula, iterations, formula->offsetX, formula->offsetY, pixelStep, width, height);
+        QueryPerformanceCounter(&perfEnd);
+        printf("%s %dx%d: rendered in %.1fms", formula->name, width, height,
+            (double)(perfEnd.QuadPart - perfStart.QuadPart) * 1000 / perfFrequency.QuadPart);
+        if (certify) printf(", %.1f%% of the area certified", 100.0 * certified / ((double)width * height));
+        printf("\n");
+        // Same limit as the renderer
+        IterFileHeader header = { .compression = ITER_RLE, .width = width, .height = height, .maxIters = 1000,
+            .formula = formulaIndex, .centerX = formula->offsetX, .centerY = formula->offsetY, .pixelStep = pixelStep };
+        int result = writeIterations(path, header, iterations);
+        if (result) fprintf(stderr, "Error writing %s\n", path);
+        free(iterations);
+        rendererExit();
+        return result;
+    }
+    uint32_t *pixels = malloc(width * height * sizeof(uint32_t));
+    StillStats stats = renderStill(formula, pixels, formula->offsetX, formula->offsetY, pixelStep,
+        width, height, samples, threshold, certify);
+    printf("%s %dx%d: main pass %.1fms, supersampled %d pixels (%.2f%%) %dx%d in %.1fms\n",
+        formula->name, width, height, stats.mainMs, stats.supersampled,
+        100.0 * stats.supersampled / (width * height), samples, samples, stats.supersampleMs);
+    if (certify) printf("Main pass certified %.1f%% of the area\n", 100.0 * stats.certified / (width * height));
+
+    if (compare) {
+        uint32_t *full = malloc(width * height * sizeof(uint32_t));
+        StillStats fullStats = renderStill(formula, full, formula->offsetX, formula->offsetY, pixelStep,
+            width, height, samples, -1, certify);
+        double fullMs = fullStats.mainMs + fullStats.supersampleMs;
+        double adaptiveMs = stats.mainMs + stats.supersampleMs;
+        // Channel difference against the full supersample shows what skipping the flat pixels cost
+        uint64_t diffSum = 0;
+        int diffMax = 0, diffPixels = 0;
+        for (int i = 0; i < width * height; i++) {
+            int pixelDiff = 0;
+            for (int shift = 0; shift < 24; shift += 8) {
+                int diff = abs((int)(pixels[i] >> shift & 0xFF) - (int)(full[i] >> shift & 0xFF));
+                diffSum += diff;
+                pixelDiff = max(pixelDiff, diff);
+            }
+            diffMax = max(diffMax, pixelDiff);
+            if (pixelDiff > 0) diffPixels++;
+        }
+        printf("Full %dx%d supersampling took %.1fms, adaptive %.1fms (%.2fx faster)\n",
+            samples, samples, fullMs, adaptiveMs, fullMs / adaptiveMs);
+        printf("Difference to full: %.2f%% of pixels, mean %.3f, max %d per channel\n",
+            100.0 * diffPixels / (width * height), (double)diffSum / (width * height * 3), diffMax);
+        free(full);
+    }
+
+    int result = writeBitmap(path, pixels, width, height);
+    if (result) fprintf(stderr, "Error writing %s\n", path);
+    free(pixels);
+    rendererExit();
+    return result;
+}
@@ -0,0 +1,58 @@
+/**
+ * Generates the calculate() kernels of one formula for every precision tier.
+ * Before including define KERNEL_NAME, KERNEL_START and KERNEL_ITERATE as for kernel.h,
+ * and KERNEL_SCALAR if KERNEL_ITERATE does not work on vectors.
+ * The double kernel is KERNEL_NAME, the others get Float and Extended suffixes.
+ * Only the double tier also gets the ResumeKernel KERNEL_NAME##Resume.
+ * Float and double kernels iterate a 16 byte vector of pixels at once, so float does twice the pixels of double.
+ */
+
+#define KERNEL_CONCAT_(a, b) a##b
+#define KERNEL_CONCAT(a, b) KERNEL_CONCAT_(a, b)
+/** Pixels gathered per escape batch */
+#define KERNEL_BATCH 64
+/** Iterations every pixel runs in scalar code before the pixels still inside are batched into vectors */
+#define KERNEL_SCALAR_ITERS 8
+/** Same as CalculateKernel */
+#define KERNEL_PARAMETERS \
+    fracInt *target, int maxIters, double paramR, double paramI, \
+    double centerX, double centerY, double pixelStep, int width, int height, \
+    short hstriping, short hstripeOffset, bool hfillIn, \
+    short vstriping, short vstripeOffset, bool vfillIn, \
+    int yStart, int yEnd, int r1xStart, int r1xEnd, \
+    bool region2, int r2xStart, int r2xEnd
+#define KERNEL_ARGUMENTS \
+    target, maxIters, paramR, paramI, centerX, centerY, pixelStep, width, height, \
+    hstriping, hstripeOffset, hfillIn, vstriping, vstripeOffset, vfillIn, \
+    yStart, yEnd, r1xStart, r1xEnd, region2, r2xStart, r2xEnd
+
+#define KERNEL_FUNCTION KERNEL_CONCAT(KERNEL_NAME, Float)
+#define KERNEL_REAL float
+#define KERNEL_LANE_INT int32_t
+#ifdef KERNEL_SCALAR
+#define KERNEL_LANES 1
+#else
+#define KERNEL_LANES 4
+#endif
+#include "kernel.h"
+
+#define KERNEL_FUNCTION KERNEL_NAME
+#define KERNEL_RESUME KERNEL_CONCAT(KERNEL_NAME, Resume)
+#define KERNEL_REAL double
+#define KERNEL_LANE_INT int64_t
+#ifdef KERNEL_SCALAR
+#define KERNEL_LANES 1
+#else
+#define KERNEL_LANES 2
+#endif
+#include "kernel.h"
+
+#define KERNEL_FUNCTION KERNEL_CONCAT(KERNEL_NAME, Extended)
+#define KERNEL_REAL long double
+#define KERNEL_LANES 1
+#include "kernel.h"
+
+#undef KERNEL_NAME
+#undef KERNEL_START
+#undef KERNEL_ITERATE
+#undef KERNEL_SCALAR
@@ -0,0 +1,93 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "renderer.h"
+#include "tiles.h"
+
+#define DEFAULT_LEVELS 4
+/** Tiles stored around the view on every side, so that panning from the known view stays paged in */
+#define MARGIN_TILES 1
+
+static int renderedTiles = 0;
+static int totalTiles = 0;
+
+void renderTile(fracInt *target, double centerX, double centerY, double pixelStep, int size) {
+    renderBlocking(&formulas[FORMULA_MANDELBROT], target, centerX, centerY, pixelStep, size, size);
+    renderedTiles++;
+    if (renderedTiles % 16 == 0 || renderedTiles == totalTiles)
+        printf("Rendered %d/%d tiles\n", renderedTiles, totalTiles);
+}
+
+/**
+ * Offline job that renders the pyramid for a view the viewer starts on or often visits.
+ * Level 0 is the view itself, every next level zooms in by one wheel step of the viewer on the same center.
+ */
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: tilegen <file> <width> <height> [levels] [threads] [centerX centerY zoom]\n");
+        return 1;
+    }
+    const char *path = argv[1];
+    int width = atoi(argv[2]);
+    int height = atoi(argv[3]);
+    int levels = argc > 4 ? atoi(argv[4]) : DEFAULT_LEVELS;
+    unsigned int threadCount = argc > 5 ? atoi(argv[5]) : 0;
+    // Same as the viewer's initial view
+    double centerX = argc > 8 ? atof(argv[6]) : -0.74;
+    double centerY = argc > 8 ? atof(argv[7]) : -0.22;
+    double zoom = argc > 8 ? atof(argv[8]) : 0.01;
+    if (width < 4 || height < 4 || levels < 1) {
+        fprintf(stderr, "Invalid view size or level count\n");
+        return 1;
+    }
+
+    if (rendererInitialize(threadCount)) {
+        fprintf(stderr, "Error initializing renderer\n");
+        rendererExit();
+        return 1;
+    }
+
+    // Same pixelStep as the viewer would use. The grid origin is the view center, which stays on the grid of
+    // every level as the viewer zooms around it
+    double basePixelStep = zoom * 2 / min(width, height);
+    TileFileHeader header = { 0 };
+    header.tileSize = TILE_SIZE;
+    header.levelCount = levels;
+    // Same as the renderer, other limits are never paged in
+    header.maxIters = 1000;
+    header.basePixelStep = basePixelStep;
+    header.originX = centerX;
+    header.originY = centerY;
+
+    TileRect *levelRects = calloc(levels, sizeof(TileRect));
+    for (int level = 0; level < levels; level++) {
+        // The view covers the same global pixels on every level
+        int left = -(int)floor((float)width / 2);
+        int top = -(int)floor((float)height / 2);
+        levelRects[level] = (TileRect){
+            (int32_t)floor((double)left / TILE_SIZE) - MARGIN_TILES,
+            (int32_t)floor((double)top / TILE_SIZE) - MARGIN_TILES,
+            (int32_t)floor((double)(left + width - 1) / TILE_SIZE) + 1 + MARGIN_TILES,
+            (int32_t)floor((double)(top + height - 1) / TILE_SIZE) + 1 + MARGIN_TILES,
+        };
+        totalTiles += (levelRects[level].x1 - levelRects[level].x0) * (levelRects[level].y1 - levelRects[level].y0);
+    }
+
+    LARGE_INTEGER perfFrequency, perfStart, perfEnd;
+    QueryPerformanceFrequency(&perfFrequency);
+    QueryPerformanceCounter(&perfStart);
+    int result = tilePyramidWrite(path, header, levelRects, renderTile);
+    QueryPerformanceCounter(&perfEnd);
+    if (result) {
+        fprintf(stderr, "Error writing %s\n", path);
+    } else {
+        printf("Wrote %d tiles in %d levels to %s in %dms\n", totalTiles, levels, path,
+            (int)((perfEnd.QuadPart * 1000 - perfStart.QuadPart * 1000) / perfFrequency.QuadPart));
+    }
+
+    free(levelRects);
+    rendererExit();
+    return result;
+}
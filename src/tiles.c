@@ -0,0 +1,200 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "tiles.h"
+
+struct TilePyramid {
+    HANDLE file;
+    HANDLE mapping;
+    const uint8_t *view;
+    uint64_t size;
+    TileFileHeader header;
+    const TileIndexEntry *index;
+};
+
+static int floorDiv(int64_t value, int divisor) {
+    return (int)(value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor));
+}
+
+TilePyramid *tilePyramidOpen(const char *path) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < sizeof(TileFileHeader)) {
+        CloseHandle(file);
+        return 0;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+        CloseHandle(file);
+        return 0;
+    }
+    const uint8_t *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return 0;
+    }
+
+    TilePyramid *pyramid = calloc(1, sizeof(TilePyramid));
+    pyramid->file = file;
+    pyramid->mapping = mapping;
+    pyramid->view = view;
+    pyramid->size = size.QuadPart;
+    memcpy(&pyramid->header, view, sizeof(TileFileHeader));
+    pyramid->index = (const TileIndexEntry*)(view + sizeof(TileFileHeader));
+
+    // Validate everything the lookups rely on once, so they don't have to
+    const TileFileHeader *header = &pyramid->header;
+    uint64_t tileBytes = (uint64_t)header->tileSize * header->tileSize * sizeof(fracInt);
+    bool valid = memcmp(header->magic, TILE_MAGIC, 4) == 0 && header->version == TILE_VERSION
+        && header->tileSize > 0 && header->basePixelStep > 0
+        && sizeof(TileFileHeader) + (uint64_t)header->tileCount * sizeof(TileIndexEntry) <= pyramid->size;
+    for (uint32_t i = 0; valid && i < header->tileCount; i++) {
+        valid = pyramid->index[i].offset % sizeof(fracInt) == 0
+            && pyramid->index[i].offset + tileBytes <= pyramid->size;
+    }
+    if (!valid) {
+        fprintf(stderr, "Invalid tile pyramid %s\n", path);
+        tilePyramidClose(pyramid);
+        return 0;
+    }
+    return pyramid;
+}
+
+void tilePyramidClose(TilePyramid *pyramid) {
+    if (!pyramid) return;
+    UnmapViewOfFile(pyramid->view);
+    CloseHandle(pyramid->mapping);
+    CloseHandle(pyramid->file);
+    free(pyramid);
+}
+
+static double levelPixelStep(const TileFileHeader *header, int level) {
+    return header->basePixelStep / pow(TILE_LEVEL_RATIO, level);
+}
+
+static int compareIndexEntry(const TileIndexEntry *a, int level, int tileX, int tileY) {
+    if (a->level != level) return a->level < level ? -1 : 1;
+    if (a->tileY != tileY) return a->tileY < tileY ? -1 : 1;
+    if (a->tileX != tileX) return a->tileX < tileX ? -1 : 1;
+    return 0;
+}
+
+const fracInt *tilePyramidTile(const TilePyramid *pyramid, int level, int tileX, int tileY) {
+    size_t low = 0, high = pyramid->header.tileCount;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        int cmp = compareIndexEntry(pyramid->index + mid, level, tileX, tileY);
+        if (cmp == 0) return (const fracInt*)(pyramid->view + pyramid->index[mid].offset);
+        if (cmp < 0) low = mid + 1;
+        else high = mid;
+    }
+    return 0;
+}
+
+bool tilePyramidFill(
+    const TilePyramid *pyramid, fracInt *target, int maxIters,
+    double centerX, double centerY, double pixelStep,
+    int width, int height
+) {
+    const TileFileHeader *header = &pyramid->header;
+    if (header->maxIters != maxIters) return false;
+
+    // Find the level with matching pixelStep
+    int level = (int)round(log(header->basePixelStep / pixelStep) / log(TILE_LEVEL_RATIO));
+    if (level < 0 || level >= header->levelCount) return false;
+    double levelStep = levelPixelStep(header, level);
+    if (fabs(levelStep - pixelStep) > pixelStep * 1e-9) return false;
+
+    // Global pixel of the view center has to lie on the level pixel grid
+    double centerGx = (centerX - header->originX) / levelStep;
+    double centerGy = (centerY - header->originY) / levelStep;
+    if (fabs(centerGx - round(centerGx)) > 1e-3 || fabs(centerGy - round(centerGy)) > 1e-3) return false;
+
+    int size = header->tileSize;
+    int64_t gxStart = (int64_t)round(centerGx) - (int)floor((float)width / 2);
+    int64_t gyStart = (int64_t)round(centerGy) - (int)floor((float)height / 2);
+    int tileX0 = floorDiv(gxStart, size), tileX1 = floorDiv(gxStart + width - 1, size);
+    int tileY0 = floorDiv(gyStart, size), tileY1 = floorDiv(gyStart + height - 1, size);
+
+    // All or nothing, a partial fill would still need a full render
+    for (int tileY = tileY0; tileY <= tileY1; tileY++) {
+        for (int tileX = tileX0; tileX <= tileX1; tileX++) {
+            if (!tilePyramidTile(pyramid, level, tileX, tileY)) return false;
+        }
+    }
+
+    for (int tileY = tileY0; tileY <= tileY1; tileY++) {
+        int64_t tileTop = (int64_t)tileY * size;
+        int rowStart = (int)max(0, tileTop - gyStart);
+        int rowEnd = (int)min(height, tileTop + size - gyStart);
+        for (int tileX = tileX0; tileX <= tileX1; tileX++) {
+            const fracInt *tile = tilePyramidTile(pyramid, level, tileX, tileY);
+            int64_t tileLeft = (int64_t)tileX * size;
+            int colStart = (int)max(0, tileLeft - gxStart);
+            int colEnd = (int)min(width, tileLeft + size - gxStart);
+            for (int py = rowStart; py < rowEnd; py++) {
+                const fracInt *source = tile + (gyStart + py - tileTop) * size + (gxStart + colStart - tileLeft);
+                memcpy(target + py * width + colStart, source, (colEnd - colStart) * sizeof(fracInt));
+            }
+        }
+    }
+    return true;
+}
+
+int tilePyramidWrite(const char *path, TileFileHeader header, const TileRect *levelRects, TileRenderFunction renderTile) {
+    memcpy(header.magic, TILE_MAGIC, 4);
+    header.version = TILE_VERSION;
+    header.tileCount = 0;
+    for (uint32_t level = 0; level < header.levelCount; level++) {
+        const TileRect *rect = levelRects + level;
+        header.tileCount += (rect->x1 - rect->x0) * (rect->y1 - rect->y0);
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (!file) return 1;
+
+    size_t tileLength = (size_t)header.tileSize * header.tileSize;
+    uint64_t indexEnd = sizeof(TileFileHeader) + (uint64_t)header.tileCount * sizeof(TileIndexEntry);
+    uint64_t dataStart = (indexEnd + TILE_DATA_ALIGN - 1) / TILE_DATA_ALIGN * TILE_DATA_ALIGN;
+
+    // Index goes in (level, tileY, tileX) order, which is also the order tiles are rendered in
+    fwrite(&header, sizeof(TileFileHeader), 1, file);
+    uint64_t offset = dataStart;
+    for (uint32_t level = 0; level < header.levelCount; level++) {
+        const TileRect *rect = levelRects + level;
+        for (int32_t tileY = rect->y0; tileY < rect->y1; tileY++) {
+            for (int32_t tileX = rect->x0; tileX < rect->x1; tileX++) {
+                TileIndexEntry entry = { level, tileX, tileY, 0, offset };
+                fwrite(&entry, sizeof(TileIndexEntry), 1, file);
+                offset += tileLength * sizeof(fracInt);
+            }
+        }
+    }
+    for (uint64_t i = indexEnd; i < dataStart; i++) fputc(0, file);
+
+    fracInt *tile = malloc(tileLength * sizeof(fracInt));
+    for (uint32_t level = 0; level < header.levelCount; level++) {
+        const TileRect *rect = levelRects + level;
+        double levelStep = levelPixelStep(&header, level);
+        for (int32_t tileY = rect->y0; tileY < rect->y1; tileY++) {
+            for (int32_t tileX = rect->x0; tileX < rect->x1; tileX++) {
+                // Tile pixel (0, 0) has to land on global pixel (tileX * size, tileY * size)
+                double centerX = header.originX + ((double)tileX * header.tileSize + header.tileSize / 2) * levelStep;
+                double centerY = header.originY + ((double)tileY * header.tileSize + header.tileSize / 2) * levelStep;
+                renderTile(tile, centerX, centerY, levelStep, header.tileSize);
+                fwrite(tile, sizeof(fracInt), tileLength, file);
+            }
+        }
+    }
+    free(tile);
+
+    int result = ferror(file) ? 1 : 0;
+    if (fclose(file) != 0) result = 1;
+    return result;
+}
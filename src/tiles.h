@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mandelbrot.h"
+
+#define TILE_MAGIC "FRTP"
+#define TILE_VERSION 2
+#define TILE_SIZE 256
+/** Zoom between levels, same as one mouse wheel step in the viewer so that every level can be reached */
+#define TILE_LEVEL_RATIO 1.5
+/** Tile data starts page aligned so that a tile is paged in without touching the index */
+#define TILE_DATA_ALIGN 4096
+
+/**
+ * File layout: TileFileHeader, TileIndexEntry[tileCount] sorted by (level, tileY, tileX),
+ * padding to TILE_DATA_ALIGN, then tileSize * tileSize fracInt values per tile.
+ * Pixel (gx, gy) of level L lies at originX + gx * pixelStep(L), originY + gy * pixelStep(L) with
+ * pixelStep(L) = basePixelStep / TILE_LEVEL_RATIO^L,
+ * tile (tileX, tileY) holds pixels [tileX * tileSize, (tileX + 1) * tileSize) and likewise for y.
+ */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t tileSize;
+    uint32_t levelCount;
+    uint32_t tileCount;
+    uint32_t maxIters;
+    double originX;
+    double originY;
+    /** pixelStep of level 0, every next level divides it by TILE_LEVEL_RATIO */
+    double basePixelStep;
+} TileFileHeader;
+
+typedef struct {
+    int32_t level;
+    int32_t tileX;
+    int32_t tileY;
+    uint32_t reserved;
+    /** Byte offset of the tile data from the start of the file */
+    uint64_t offset;
+} TileIndexEntry;
+
+/** Tiles [x0, x1) x [y0, y1) stored for one level */
+typedef struct {
+    int32_t x0; int32_t y0;
+    int32_t x1; int32_t y1;
+} TileRect;
+
+typedef struct TilePyramid TilePyramid;
+
+/** Renders size x size pixels centered at centerX, centerY */
+typedef void (*TileRenderFunction)(fracInt *target, double centerX, double centerY, double pixelStep, int size);
+
+TilePyramid *tilePyramidOpen(const char *path);
+void tilePyramidClose(TilePyramid *pyramid);
+/** Returns the mapped tile data or 0 when the tile is not stored */
+const fracInt *tilePyramidTile(const TilePyramid *pyramid, int level, int tileX, int tileY);
+/**
+ * Copies the viewport out of the mapped tiles.
+ * Fails without touching target unless the view is on a stored level, aligned to its pixel grid and fully stored.
+ */
+bool tilePyramidFill(
+    const TilePyramid *pyramid, fracInt *target, int maxIters,
+    double centerX, double centerY, double pixelStep,
+    int width, int height
+);
+/**
+ * Writes a pyramid with header->levelCount levels, levelRects[level] selecting the stored tiles.
+ * tileCount is filled in by the writer.
+ */
+int tilePyramidWrite(const char *path, TileFileHeader header, const TileRect *levelRects, TileRenderFunction renderTile);
@@ -0,0 +1,173 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "renderer.h"
+
+/** Client area of the viewer's initial window */
+#define TUNE_WIDTH 1184
+#define TUNE_HEIGHT 921
+#define TUNE_PANS 8
+#define TUNE_PAN_PIXELS 24
+#define DEFAULT_REPEATS 3
+/** A frame that takes longer than this counts as this long */
+#define TIMEOUT_MS 30000
+#define FRAME_MS 16
+
+/** The workload runs on the initial views of these */
+static const int canonicalFormulas[] = { FORMULA_MANDELBROT, FORMULA_JULIA, FORMULA_TRICORN, FORMULA_MULTIBROT3 };
+#define CANONICAL_COUNT (int)(sizeof(canonicalFormulas) / sizeof(canonicalFormulas[0]))
+
+static const unsigned int threadChoices[] = { 1, 2, 3, 4, 6, 8, 12, 16 };
+static const int maxTasksChoices[] = { 12, 25, 50, 100, 150, 200, 256 };
+static const int panTaskPixelsChoices[] = { 2500, 5000, 10000, 20000, 40000 };
+static const int progressiveBudgetChoices[] = { 40, 60, 80, 120, 160 };
+
+static LARGE_INTEGER perfFrequency;
+static uint32_t *pixels;
+
+static double nowMs() {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart * 1000 / perfFrequency.QuadPart;
+}
+
+/** Time until the renderer shows the latest input completely, redrawing like the viewer meanwhile */
+static double waitComplete(Renderer *renderer, double startMs) {
+    FrameStatus status = { 0 };
+    double lastDrawMs = 0;
+    while (nowMs() - startMs < TIMEOUT_MS) {
+        if (rendererFrameStatus(renderer, &status) && status.complete) break;
+        if (nowMs() - lastDrawMs >= FRAME_MS) {
+            lastDrawMs = nowMs();
+            tryRedraw32(renderer, pixels, TUNE_WIDTH, TUNE_HEIGHT);
+        }
+        Sleep(1);
+    }
+    return nowMs() - startMs;
+}
+
+/**
+ * Each canonical view is rendered from scratch, then panned and zoomed into, every input waiting for the one before
+ * to be complete. Returns the total time in ms on a fresh renderer.
+ */
+static double runWorkload() {
+    Renderer *renderer = rendererCreate();
+    if (!renderer) return TIMEOUT_MS * 1e3;
+    double totalMs = 0;
+    resizeFrame(renderer, TUNE_WIDTH, TUNE_HEIGHT);
+    for (int v = 0; v < CANONICAL_COUNT; v++) {
+        double startMs = nowMs();
+        setFormula(renderer, canonicalFormulas[v]);
+        totalMs += waitComplete(renderer, startMs);
+        for (int pan = 0; pan < TUNE_PANS; pan++) {
+            startMs = nowMs();
+            panFrame(renderer, pan % 2 ? -TUNE_PAN_PIXELS : TUNE_PAN_PIXELS, TUNE_PAN_PIXELS / 2);
+            totalMs += waitComplete(renderer, startMs);
+        }
+        startMs = nowMs();
+        zoomFrame(renderer, TUNE_WIDTH / 2, TUNE_HEIGHT / 2, -1);
+        totalMs += waitComplete(renderer, startMs);
+    }
+    rendererDestroy(renderer);
+    return totalMs;
+}
+
+static int compareDouble(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+/** Median workload time of repeats runs with tuning, restarting the worker pool when the thread count changes */
+static double measure(const RendererTuning *tuning, int repeats) {
+    static unsigned int runningThreads = 0;
+    if (tuning->threads != runningThreads) {
+        if (runningThreads) rendererExit();
+        if (rendererInitialize(tuning->threads)) {
+            fprintf(stderr, "Error initializing renderer\n");
+            exit(1);
+        }
+        runningThreads = tuning->threads;
+    }
+    rendererSetTuning(tuning);
+    double times[16];
+    repeats = min(repeats, 16);
+    for (int r = 0; r < repeats; r++) times[r] = runWorkload();
+    qsort(times, repeats, sizeof(double), compareDouble);
+    return times[repeats / 2];
+}
+
+static void printTuning(const char *label, const RendererTuning *tuning, double ms) {
+    printf("%-9s %2u threads, %3d tasks, %5d pixels per pan task, %3dms progressive budget: %.0fms\n",
+        label, tuning->threads, tuning->maxTasks, tuning->panTaskPixels, tuning->progressiveBudgetMs, ms);
+}
+
+/**
+ * Searches the renderer's tuning knobs one after the other on this machine, keeping the best value of each,
+ * and writes the result to the profile the renderer loads on start. The measure is the time until a fixed
+ * sequence of renders, pans and zooms over the canonical views is complete.
+ */
+int main(int argc, char **argv) {
+    int repeats = argc > 1 ? atoi(argv[1]) : DEFAULT_REPEATS;
+    if (repeats < 1) {
+        fprintf(stderr, "Usage: tune [repeats]\n");
+        return 1;
+    }
+    QueryPerformanceFrequency(&perfFrequency);
+    pixels = malloc(TUNE_WIDTH * TUNE_HEIGHT * sizeof(uint32_t));
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    unsigned int processors = info.dwNumberOfProcessors;
+
+    RendererTuning best = defaultTuning;
+    double defaultMs = measure(&best, repeats), bestMs = defaultMs;
+    printTuning("defaults", &best, defaultMs);
+
+    // Coordinate descent, each knob searched with the best values found for the ones before
+    for (int knob = 0; knob < 4; knob++) {
+        int choices = knob == 0 ? sizeof(threadChoices) / sizeof(threadChoices[0])
+                    : knob == 1 ? sizeof(maxTasksChoices) / sizeof(maxTasksChoices[0])
+                    : knob == 2 ? sizeof(panTaskPixelsChoices) / sizeof(panTaskPixelsChoices[0])
+                    : sizeof(progressiveBudgetChoices) / sizeof(progressiveBudgetChoices[0]);
+        RendererTuning knobBest = best;
+        for (int c = 0; c < choices; c++) {
+            RendererTuning candidate = best;
+            if (knob == 0) {
+                // More threads than twice the processors only add switching
+                if (threadChoices[c] > 2 * processors) continue;
+                candidate.threads = threadChoices[c];
+            }
+            if (knob == 1) candidate.maxTasks = maxTasksChoices[c];
+            if (knob == 2) candidate.panTaskPixels = panTaskPixelsChoices[c];
+            if (knob == 3) candidate.progressiveBudgetMs = progressiveBudgetChoices[c];
+            if (!memcmp(&candidate, &best, sizeof(candidate))) continue;
+            double ms = measure(&candidate, repeats);
+            printTuning("candidate", &candidate, ms);
+            if (ms < bestMs) {
+                bestMs = ms;
+                knobBest = candidate;
+            }
+        }
+        best = knobBest;
+    }
+
+    // Both again, so that the gain does not come from the machine warming up during the search
+    double tunedMs = measure(&best, repeats);
+    defaultMs = measure(&defaultTuning, repeats);
+    printTuning("defaults", &defaultTuning, defaultMs);
+    printTuning("tuned", &best, tunedMs);
+    if (tunedMs >= defaultMs) {
+        printf("No gain over the defaults on this machine, keeping them\n");
+        best = defaultTuning;
+        tunedMs = defaultMs;
+    }
+    printf("Tuned workload takes %.0fms against %.0fms with the defaults, %.2fx\n", tunedMs, defaultMs, defaultMs / tunedMs);
+
+    int result = saveTuning(TUNING_PATH, &best);
+    if (result) fprintf(stderr, "Error writing %s\n", TUNING_PATH);
+    else printf("Wrote %s\n", TUNING_PATH);
+    rendererExit();
+    free(pixels);
+    return result;
+}
@@ -4,14 +4,22 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 
 #include "renderer.h"
+#include "replay.h"
 
-#define DEFAULT_WORKER_THREADS 3
 #define FRAME_RATE 60
+#define FRAME_TIMER_ID 1
+/** Shared memory frames are published to with -export, framewatch reads it by default */
+#define FRAME_RING_NAME "brotFrames"
 
 static bool quit = false;
+static Renderer *renderer = 0;
+/** Input is written to it with -record for replay */
+static FILE *recording = 0;
+static LARGE_INTEGER recordingStart;
 
 LRESULT CALLBACK WindowProcessMessage(HWND, UINT, WPARAM, LPARAM);
 
@@ -25,6 +33,13 @@ struct {
     uint32_t *pixels;
 } frame = {0};
 
+/** Latest WM_SIZE, applied once per frame so that a drag-resize does not recreate the bitmap for every event */
+struct {
+    bool pending;
+    int width;
+    int height;
+} pendingResize = {0};
+
 typedef struct Dimensions {
     int x;
     int y;
@@ -66,6 +81,43 @@ Dimensions getBorderDimensions(HWND windowHandle) {
     return result;
 }
 
+void recordEvent(ReplayKind kind, int a, int b, int c) {
+    if (!recording) return;
+    LARGE_INTEGER perfFrequency, perfNow;
+    QueryPerformanceFrequency(&perfFrequency);
+    QueryPerformanceCounter(&perfNow);
+    replayWrite(recording, (ReplayEvent){
+        (double)(perfNow.QuadPart - recordingStart.QuadPart) * 1000 / perfFrequency.QuadPart, kind, a, b, c });
+}
+
+void applyPendingResize() {
+    if (!pendingResize.pending) return;
+    pendingResize.pending = false;
+
+    frame_bitmap_info.bmiHeader.biWidth  = pendingResize.width;
+    frame_bitmap_info.bmiHeader.biHeight = -pendingResize.height;
+
+    if(frame_bitmap) DeleteObject(frame_bitmap);
+    frame_bitmap = CreateDIBSection(NULL, &frame_bitmap_info, DIB_RGB_COLORS, (void**)&frame.pixels, 0, 0);
+    SelectObject(frame_device_context, frame_bitmap);
+
+    frame.width =  pendingResize.width;
+    frame.height = pendingResize.height;
+
+    if (renderer) {
+        resizeFrame(renderer, frame.width, frame.height);
+        recordEvent(REPLAY_RESIZE, frame.width, frame.height, 0);
+    }
+}
+
+void redrawFrame(HWND windowHandle) {
+    applyPendingResize();
+    if (tryRedraw32(renderer, frame.pixels, frame.width, frame.height)) {
+        InvalidateRect(windowHandle, NULL, FALSE);
+        UpdateWindow(windowHandle);
+    }
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine, int nCmdShow) {
     const wchar_t window_class_name[] = L"My Window Class";
     static WNDCLASS window_class = { 0 };
@@ -85,15 +137,32 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
                                  500, 40, 1200, 960, NULL, NULL, hInstance, NULL);
     if(windowHandle == NULL) { return -1; }
     
+    // 0 when not given, the renderer then takes the count from the tuning profile or its default
     unsigned int threadCount = atoi(pCmdLine);
-    if (threadCount == 0) threadCount = DEFAULT_WORKER_THREADS;
-    if (rendererInitialize(threadCount)) {
+    if (rendererInitialize(threadCount) || !(renderer = rendererCreate())) {
         fprintf(stderr, "Error initializing renderer\n");
         rendererExit();
         return -1;
     }
+    // Optional further arguments are a tile pyramid made by tilegen, -export to publish frames for framewatch
+    // and -record followed by a file to write the input to for replay
+    char *arguments = strchr(pCmdLine, ' ');
+    for (char *argument = arguments ? strtok(arguments, " ") : 0; argument; argument = strtok(NULL, " ")) {
+        if (strcmp(argument, "-record") == 0) {
+            char *path = strtok(NULL, " ");
+            if (path && !(recording = fopen(path, "w"))) fprintf(stderr, "Could not create recording %s\n", path);
+            QueryPerformanceCounter(&recordingStart);
+        } else if (strcmp(argument, "-export") == 0) {
+            if (rendererExportFrames(renderer, FRAME_RING_NAME,
+                GetSystemMetrics(SM_CXVIRTUALSCREEN), GetSystemMetrics(SM_CYVIRTUALSCREEN), true, true))
+                fprintf(stderr, "Could not create frame ring %s\n", FRAME_RING_NAME);
+        } else if (rendererOpenTiles(renderer, argument)) {
+            fprintf(stderr, "Could not open tile pyramid %s\n", argument);
+        }
+    }
     Dimensions initialSize = getClientDimensions(windowHandle);
-    resizeFrame(initialSize.x, initialSize.y);
+    resizeFrame(renderer, initialSize.x, initialSize.y);
+    recordEvent(REPLAY_RESIZE, initialSize.x, initialSize.y, 0);
 
     timeBeginPeriod(1);
     LARGE_INTEGER perfFrequency, perfStart, perfNext, perfCurr;
@@ -133,14 +202,13 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pCmdLine,
         micros = (perfCurr.QuadPart * 1000000 - perfStart.QuadPart * 1000000) / perfFrequency.QuadPart;
         perfNext.QuadPart += perfFrequency.QuadPart / FRAME_RATE;
 
-        if (tryRedraw32(frame.pixels, frame.width, frame.height)) {
-            InvalidateRect(windowHandle, NULL, FALSE);
-            UpdateWindow(windowHandle);
-        }
+        redrawFrame(windowHandle);
     }
 
     timeEndPeriod(1);
 
+    if (recording) fclose(recording);
+    rendererDestroy(renderer);
     rendererExit();
     return 0;
 }
@@ -171,20 +239,25 @@ LRESULT CALLBACK WindowProcessMessage(HWND windowHandle, UINT message, WPARAM wP
         } break;
 
         case WM_SIZE: {
-            int width = LOWORD(lParam);
-            int height = HIWORD(lParam);
-
-            frame_bitmap_info.bmiHeader.biWidth  = width;
-            frame_bitmap_info.bmiHeader.biHeight = -height;
+            pendingResize.width = LOWORD(lParam);
+            pendingResize.height = HIWORD(lParam);
+            pendingResize.pending = true;
+            // Before the message loop runs there is no frame to draw into
+            if (!frame.pixels) applyPendingResize();
+        } break;
 
-            if(frame_bitmap) DeleteObject(frame_bitmap);
-            frame_bitmap = CreateDIBSection(NULL, &frame_bitmap_info, DIB_RGB_COLORS, (void**)&frame.pixels, 0, 0);
-            SelectObject(frame_device_context, frame_bitmap);
+        // Dragging the border runs a modal loop that starves the main loop, keep drawing on a timer meanwhile
+        case WM_ENTERSIZEMOVE: {
+            SetTimer(windowHandle, FRAME_TIMER_ID, 1000 / FRAME_RATE, NULL);
+        } break;
 
-            frame.width =  width;
-            frame.height = height;
+        case WM_EXITSIZEMOVE: {
+            KillTimer(windowHandle, FRAME_TIMER_ID);
+            redrawFrame(windowHandle);
+        } break;
 
-            resizeFrame(frame.width, frame.height);
+        case WM_TIMER: {
+            if (wParam == FRAME_TIMER_ID) redrawFrame(windowHandle);
         } break;
 
         case WM_MOUSEMOVE:
@@ -196,7 +269,8 @@ LRESULT CALLBACK WindowProcessMessage(HWND windowHandle, UINT message, WPARAM wP
             bool newRight = wParam & MK_RBUTTON ? true : false;
             if (MouseStatus.left == true && newLeft == true && (MouseStatus.x != newX || MouseStatus.y != newY)) {
                 // printf("Pan by: %d, %d\n", newX - MouseStatus.x, newY - MouseStatus.y);
-                panFrame(newX - MouseStatus.x, newY - MouseStatus.y);
+                panFrame(renderer, newX - MouseStatus.x, newY - MouseStatus.y);
+                recordEvent(REPLAY_PAN, newX - MouseStatus.x, newY - MouseStatus.y, 0);
             }
             MouseStatus.x = newX; MouseStatus.y = newY;
             MouseStatus.left = newLeft; MouseStatus.right = newRight;
@@ -206,7 +280,16 @@ LRESULT CALLBACK WindowProcessMessage(HWND windowHandle, UINT message, WPARAM wP
             // printf("scroll %d\n", (int16_t)HIWORD(wParam));
             int newX = LOWORD(lParam);
             int newY = HIWORD(lParam);
-            zoomFrame(newX, newY, (int16_t)HIWORD(wParam) < 0 ? 1 : -1);
+            zoomFrame(renderer, newX, newY, (int16_t)HIWORD(wParam) < 0 ? 1 : -1);
+            recordEvent(REPLAY_ZOOM, newX, newY, (int16_t)HIWORD(wParam) < 0 ? 1 : -1);
+        } break;
+
+        case WM_KEYDOWN: {
+            // Number keys switch formulas
+            if (wParam >= '1' && wParam <= '9') {
+                setFormula(renderer, wParam - '1');
+                recordEvent(REPLAY_FORMULA, wParam - '1', 0, 0);
+            }
         } break;
 
         case WM_MOUSELEAVE: {
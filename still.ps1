@@ -0,0 +1,42 @@
+param(
+    [Parameter(Position=0, Mandatory=$true)]
+    [string]$file,
+
+    [Parameter(Position=1, Mandatory=$true)]
+    [int]$width,
+
+    [Parameter(Position=2, Mandatory=$true)]
+    [int]$height,
+
+    [Parameter(Position=3)]
+    [int]$samples = 3,
+
+    [Parameter(Position=4)]
+    [int]$threshold = 0,
+
+    [Parameter(Position=5)]
+    [int]$threads = 0,
+
+    [Parameter(Position=6)]
+    [int]$formula = 1,
+
+    [switch]$compare,
+
+    [switch]$certify
+)
+
+if (-not (Test-Path -Path ".\out")) {
+    New-Item -Path "." -Name "out" -ItemType "Directory"
+}
+
+gcc -O2 src\mandelbrot.c src\renderer.c src\tiles.c src\framering.c src\still.c -o out\still.exe -lwinmm
+if ( $LastExitCode -ne 0)
+{
+    echo "Failed to compile"
+    Exit
+}
+
+$compareArgument = if ( $compare ) { "-compare" } else { "" }
+$certifyArgument = if ( $certify ) { "-certify" } else { "" }
+
+.\out\still.exe $file $width $height $samples $threshold $threads $formula $compareArgument $certifyArgument
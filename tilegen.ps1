@@ -0,0 +1,29 @@
+param(
+    [Parameter(Position=0, Mandatory=$true)]
+    [string]$file,
+
+    [Parameter(Position=1, Mandatory=$true)]
+    [int]$width,
+
+    [Parameter(Position=2, Mandatory=$true)]
+    [int]$height,
+
+    [Parameter(Position=3)]
+    [int]$levels = 4,
+
+    [Parameter(Position=4)]
+    [int]$threads = 0
+)
+
+if (-not (Test-Path -Path ".\out")) {
+    New-Item -Path "." -Name "out" -ItemType "Directory"
+}
+
+gcc src\mandelbrot.c src\renderer.c src\tiles.c src\framering.c src\tilegen.c -o out\tilegen.exe -lwinmm
+if ( $LastExitCode -ne 0)
+{
+    echo "Failed to compile"
+    Exit
+}
+
+.\out\tilegen.exe $file $width $height $levels $threads